@@ -72,6 +72,7 @@ def write_mpi(user_dict):
         "numerically_exact": user_dict["MPI"]["numerically_exact"],
         "shared_memory_size": user_dict["MPI"]["shared_memory_size"],
         "bank_size": user_dict["MPI"]["bank_size"],
+        "helmholtz_memory_size": user_dict["MPI"]["helmholtz_memory_size"],
     }
     return mpi_dict
 
@@ -182,7 +183,13 @@ def write_rsp_calculations(user_dict, mol_dict, origin):
     nuc_spec = user_dict["NMRShielding"]["nuclear_specific"]
 
     if run_pol:
-        for omega in user_dict["Polarizability"]["frequency"]:
+        frequencies = user_dict["Polarizability"]["frequency"]
+        run_sweep = user_dict["Polarizability"]["frequency_sweep"] and len(frequencies) > 1
+        if run_sweep and user_dict["Response"]["batch_components"]:
+            raise RuntimeError(
+                "Polarizability.frequency_sweep cannot be combined with Response.batch_components"
+            )
+        for omega in frequencies:
             freq_key = f"{omega:6f}"
             pol_key = "pol-" + freq_key
             rsp_calc = write_rsp_calc(omega, user_dict, origin)
@@ -195,8 +202,18 @@ def write_rsp_calculations(user_dict, mol_dict, origin):
                 "operator": "h_e_dip",
                 "r_O": origin,
             }
-            rsp_key = "ext_el-" + freq_key
-            rsp_dict[rsp_key] = rsp_calc
+            if run_sweep:
+                # All frequencies in a single calculation, in the given order
+                if "ext_el-sweep" not in rsp_dict:
+                    rsp_calc["frequencies"] = []
+                    rsp_dict["ext_el-sweep"] = rsp_calc
+                sweep_calc = rsp_dict["ext_el-sweep"]
+                sweep_calc["frequencies"].append(omega)
+                pol_dict = rsp_calc["properties"]["polarizability"]
+                sweep_calc["properties"]["polarizability"].update(pol_dict)
+            else:
+                rsp_key = "ext_el-" + freq_key
+                rsp_dict[rsp_key] = rsp_calc
 
     if run_mag or (run_nmr and not nuc_spec):
         omega = 0.0  # only static magnetic response
@@ -236,6 +253,7 @@ def write_rsp_calculations(user_dict, mol_dict, origin):
                         "derivative": user_dict["Derivatives"]["h_m_pso"],
                         "r_O": origin,
                         "r_K": nuclei[k]["xyz"],
+                        "batch": user_dict["NMRShielding"]["batch_nuclei"],
                     }
         rsp_key = "ext_mag-" + freq_key
         rsp_dict[rsp_key] = rsp_calc
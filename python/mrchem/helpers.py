@@ -114,6 +114,7 @@ def write_scf_fock(user_dict, wf_dict, origin):
             "xc_functional": {
                 "spin": user_dict["DFT"]["spin"],
                 "cutoff": user_dict["DFT"]["density_cutoff"],
+                "derivative": user_dict["Derivatives"]["dft"],
                 "functionals": func_dict,
             },
         }
@@ -138,7 +139,7 @@ def write_scf_guess(user_dict, wf_dict):
     guess_prec = scf_dict["guess_prec"]
 
     if guess_type == "chk":
-        chk_Phi = Path(f"{scf_dict['path_checkpoint']}/phi_scf")
+        chk_Phi = Path(f"{scf_dict['path_checkpoint']}/phi_scf_idx_0.meta")
         if not chk_Phi.is_file():
             print(
                 f"No checkpoint guess found in {scf_dict['path_checkpoint']}, falling back to 'sad_gto' initial guess"
@@ -184,6 +185,7 @@ def write_scf_guess(user_dict, wf_dict):
         "external_field": wf_dict["external_name"],
         "screen": scf_dict["guess_screen"],
         "localize": scf_dict["localize"],
+        "rotate": not (scf_dict["checkpoint_state"] and guess_type == "chk"),
         "restricted": user_dict["WaveFunction"]["restricted"],
         "file_chk": f"{scf_dict['path_checkpoint']}/phi_scf",
         "file_basis": file_dict["guess_basis"],
@@ -215,14 +217,25 @@ def write_scf_solver(user_dict, wf_dict):
         "relativity": wf_dict["relativity_name"],
         "environment": wf_dict["environment_name"],
         "external_field": wf_dict["external_name"],
+        "accelerator": scf_dict["accelerator"].lower(),
         "kain": scf_dict["kain"],
+        "kain_rotation": scf_dict["kain_rotation"],
+        "kain_memory": scf_dict["kain_memory"],
+        "kain_crop_prec": scf_dict["kain_crop_prec"],
+        "kain_path": scf_dict["kain_path"],
         "max_iter": scf_dict["max_iter"],
         "rotation": scf_dict["rotation"],
         "localize": scf_dict["localize"],
+        "freeze_orbitals": scf_dict["freeze_orbitals"],
+        "orthonormalize_once": scf_dict["orthonormalize_once"],
         "file_chk": scf_dict["path_checkpoint"] + "/phi_scf",
         "checkpoint": scf_dict["write_checkpoint"],
+        "checkpoint_state": scf_dict["checkpoint_state"],
+        "restart_state": scf_dict["checkpoint_state"]
+        and scf_dict["guess_type"].lower() == "chk",
         "start_prec": start_prec,
         "final_prec": final_prec,
+        "start_order": scf_dict["start_order"],
         "energy_thrs": scf_dict["energy_thrs"],
         "orbital_thrs": scf_dict["orbital_thrs"],
         "helmholtz_prec": user_dict["Precisions"]["helmholtz_prec"],
@@ -289,6 +302,7 @@ def write_rsp_calc(omega, user_dict, origin):
     rsp_calc = {}
     rsp_calc["frequency"] = omega
     rsp_calc["dynamic"] = omega > 1.0e-12
+    rsp_calc["batch_components"] = rsp_dict["batch_components"]
     rsp_calc["fock_operator"] = write_rsp_fock(user_dict, wf_dict)
     rsp_calc["unperturbed"] = {
         "precision": user_dict["world_prec"],
@@ -400,6 +414,7 @@ def write_rsp_fock(user_dict, wf_dict):
             "xc_functional": {
                 "spin": user_dict["DFT"]["spin"],
                 "cutoff": user_dict["DFT"]["density_cutoff"],
+                "derivative": user_dict["Derivatives"]["dft"],
                 "functionals": func_dict,
             },
         }
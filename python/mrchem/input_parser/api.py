@@ -227,6 +227,9 @@ def stencil() -> JSONDict:
                                             'type': 'bool'},
                                         {   'default': -1,
                                             'name': 'bank_size',
+                                            'type': 'int'},
+                                        {   'default': 2000,
+                                            'name': 'helmholtz_memory_size',
                                             'type': 'int'}],
                         'name': 'MPI'},
                     {   'keywords': [   {   'default': -1,
@@ -251,6 +254,15 @@ def stencil() -> JSONDict:
                                             'type': 'str'},
                                         {   'default': 'abgv_00',
                                             'name': 'zora',
+                                            'type': 'str'},
+                                        {   'default': 'abgv_00',
+                                            'name': 'dft',
+                                            'predicates': [   'value.lower() '
+                                                              'in '
+                                                              "['abgv_00', "
+                                                              "'abgv_55', "
+                                                              "'bspline', "
+                                                              "'local']"],
                                             'type': 'str'}],
                         'name': 'Derivatives'},
                     {   'keywords': [   {   'default': 0,
@@ -357,14 +369,20 @@ def stencil() -> JSONDict:
                         'name': 'ExternalFields'},
                     {   'keywords': [   {   'default': [0.0],
                                             'name': 'frequency',
-                                            'type': 'List[float]'}],
+                                            'type': 'List[float]'},
+                                        {   'default': False,
+                                            'name': 'frequency_sweep',
+                                            'type': 'bool'}],
                         'name': 'Polarizability'},
                     {   'keywords': [   {   'default': False,
                                             'name': 'nuclear_specific',
                                             'type': 'bool'},
                                         {   'default': [-1],
                                             'name': 'nucleus_k',
-                                            'type': 'List[int]'}],
+                                            'type': 'List[int]'},
+                                        {   'default': False,
+                                            'name': 'batch_nuclei',
+                                            'type': 'bool'}],
                         'name': 'NMRShielding'},
                     {   'keywords': [   {   'default': 'initial_guess/mrchem.bas',
                                             'name': 'guess_basis',
@@ -442,15 +460,40 @@ def stencil() -> JSONDict:
                                         {   'default': 100,
                                             'name': 'max_iter',
                                             'type': 'int'},
+                                        {   'default': 'kain',
+                                            'name': 'accelerator',
+                                            'predicates': [   'value.lower() '
+                                                              "in ['kain', "
+                                                              "'diis']"],
+                                            'type': 'str'},
                                         {   'default': 5,
                                             'name': 'kain',
                                             'type': 'int'},
+                                        {   'default': -1,
+                                            'name': 'kain_rotation',
+                                            'type': 'int'},
+                                        {   'default': -1,
+                                            'name': 'kain_memory',
+                                            'type': 'int'},
+                                        {   'default': -1.0,
+                                            'name': 'kain_crop_prec',
+                                            'type': 'float'},
+                                        {   'default': '.',
+                                            'name': 'kain_path',
+                                            'predicates': ["value[-1] != '/'"],
+                                            'type': 'str'},
                                         {   'default': 0,
                                             'name': 'rotation',
                                             'type': 'int'},
                                         {   'default': False,
                                             'name': 'localize',
                                             'type': 'bool'},
+                                        {   'default': False,
+                                            'name': 'freeze_orbitals',
+                                            'type': 'bool'},
+                                        {   'default': False,
+                                            'name': 'orthonormalize_once',
+                                            'type': 'bool'},
                                         {   'default': -1.0,
                                             'name': 'energy_thrs',
                                             'type': 'float'},
@@ -468,6 +511,9 @@ def stencil() -> JSONDict:
                                         {   'default': -1.0,
                                             'name': 'final_prec',
                                             'type': 'float'},
+                                        {   'default': -1,
+                                            'name': 'start_order',
+                                            'type': 'int'},
                                         {   'default': 'sad_gto',
                                             'name': 'guess_type',
                                             'predicates': [   'value.lower() '
@@ -491,6 +537,9 @@ def stencil() -> JSONDict:
                                             'name': 'path_checkpoint',
                                             'predicates': ["value[-1] != '/'"],
                                             'type': 'str'},
+                                        {   'default': False,
+                                            'name': 'checkpoint_state',
+                                            'type': 'bool'},
                                         {   'default': False,
                                             'name': 'write_orbitals',
                                             'type': 'bool'},
@@ -512,6 +561,9 @@ def stencil() -> JSONDict:
                                         {   'default': 5,
                                             'name': 'kain',
                                             'type': 'int'},
+                                        {   'default': False,
+                                            'name': 'batch_components',
+                                            'type': 'bool'},
                                         {   'default': -1.0,
                                             'name': 'property_thrs',
                                             'type': 'float'},
@@ -108,6 +108,10 @@ public:
     void printProperties() const;
 
     void initPerturbedOrbitals(bool dynamic);
+    void setPerturbedOrbitals(std::shared_ptr<OrbitalVector> x, std::shared_ptr<OrbitalVector> y) {
+        this->orbitals_x = x;
+        this->orbitals_y = y;
+    }
     void initCavity(const std::vector<mrcpp::Coord<3>> &coords, const std::vector<double> &R, const std::vector<double> &alphas, const std::vector<double> &betas, const std::vector<double> &sigmas);
 
     SCFEnergy &getSCFEnergy() { return this->energy; }
@@ -51,6 +51,7 @@
 
 #include "qmoperators/one_electron/ElectricFieldOperator.h"
 #include "qmoperators/one_electron/KineticOperator.h"
+#include "qmoperators/one_electron/MomentumOperator.h"
 #include "qmoperators/one_electron/NuclearGradientOperator.h"
 #include "qmoperators/one_electron/NuclearOperator.h"
 #include "qmoperators/one_electron/ZoraOperator.h"
@@ -64,6 +65,7 @@
 #include "qmoperators/one_electron/H_MB_dia.h"
 #include "qmoperators/one_electron/H_M_fc.h"
 #include "qmoperators/one_electron/H_M_pso.h"
+#include "qmoperators/qmoperator_utils.h"
 
 #include "qmoperators/two_electron/CoulombOperator.h"
 #include "qmoperators/two_electron/ExchangeOperator.h"
@@ -72,6 +74,7 @@
 #include "qmoperators/two_electron/XCOperator.h"
 
 #include "scf_solver/GroundStateSolver.h"
+#include "scf_solver/HelmholtzVector.h"
 #include "scf_solver/KAIN.h"
 #include "scf_solver/LinearResponseSolver.h"
 
@@ -103,12 +106,14 @@ namespace driver {
 DerivativeOperator_p get_derivative(const std::string &name);
 template <int I> RankOneOperator<I> get_operator(const std::string &name, const json &json_oper);
 template <int I, int J> RankTwoOperator<I, J> get_operator(const std::string &name, const json &json_oper);
-void build_fock_operator(const json &input, Molecule &mol, FockBuilder &F, int order);
+void build_fock_operator(const json &input, Molecule &mol, FockBuilder &F, int order, XCOperator *xc_ref = nullptr);
 void init_properties(const json &json_prop, Molecule &mol);
 
 namespace scf {
 bool guess_orbitals(const json &input, Molecule &mol);
 bool guess_energy(const json &input, Molecule &mol, FockBuilder &F);
+void setup_solver(const json &input, GroundStateSolver &solver);
+json run_start_order(const json &input, Molecule &mol);
 void write_orbitals(const json &input, Molecule &mol);
 void calc_properties(const json &input, Molecule &mol);
 void plot_quantities(const json &input, Molecule &mol);
@@ -116,6 +121,10 @@ void plot_quantities(const json &input, Molecule &mol);
 
 namespace rsp {
 bool guess_orbitals(const json &input, Molecule &mol);
+void setup_solver(const json &input, LinearResponseSolver &solver);
+bool run_batched(const json &input, Molecule &mol, FockBuilder &F_0, RankOneOperator<3> &h_1, json &json_out);
+bool run_sweep(const json &input, Molecule &mol, FockBuilder &F_0, RankOneOperator<3> &h_1, json &json_out);
+void extrapolate_orbitals(double omega, const std::vector<double> &omega_prev, std::vector<OrbitalVector> &X_prev, std::vector<OrbitalVector> &Y_prev, Molecule &mol);
 void write_orbitals(const json &input, Molecule &mol, bool dynamic);
 void calc_properties(const json &input, Molecule &mol, int dir, double omega);
 } // namespace rsp
@@ -262,36 +271,17 @@ json driver::scf::run(const json &json_scf, Molecule &mol) {
     if (json_scf.contains("scf_solver")) {
         print_utils::headline(0, "Computing Ground State Wavefunction");
 
-        auto kain = json_scf["scf_solver"]["kain"];
-        auto method = json_scf["scf_solver"]["method"];
-        auto relativity = json_scf["scf_solver"]["relativity"];
-        auto environment = json_scf["scf_solver"]["environment"];
-        auto external_field = json_scf["scf_solver"]["external_field"];
-        auto max_iter = json_scf["scf_solver"]["max_iter"];
-        auto rotation = json_scf["scf_solver"]["rotation"];
-        auto localize = json_scf["scf_solver"]["localize"];
-        auto file_chk = json_scf["scf_solver"]["file_chk"];
-        auto checkpoint = json_scf["scf_solver"]["checkpoint"];
-        auto start_prec = json_scf["scf_solver"]["start_prec"];
-        auto final_prec = json_scf["scf_solver"]["final_prec"];
-        auto energy_thrs = json_scf["scf_solver"]["energy_thrs"];
-        auto orbital_thrs = json_scf["scf_solver"]["orbital_thrs"];
-        auto helmholtz_prec = json_scf["scf_solver"]["helmholtz_prec"];
+        // Converge the first stage with a lower order basis
+        int start_order = json_scf["scf_solver"]["start_order"];
+        bool restart_state = json_scf["scf_solver"]["restart_state"];
+        bool start_stage = (start_order > 0 and start_order < MRA->getOrder() and not restart_state);
+        if (start_stage) {
+            json_out["scf_solver_start"] = scf::run_start_order(json_scf, mol);
+            if (not json_out["scf_solver_start"]["converged"].get<bool>()) MSG_WARN("Lower order SCF stage not converged");
+        }
 
         GroundStateSolver solver;
-        solver.setHistory(kain);
-        solver.setRotation(rotation);
-        solver.setLocalize(localize);
-        solver.setMethodName(method);
-        solver.setRelativityName(relativity);
-        solver.setEnvironmentName(environment);
-        solver.setExternalFieldName(external_field);
-        solver.setCheckpoint(checkpoint);
-        solver.setCheckpointFile(file_chk);
-        solver.setMaxIterations(max_iter);
-        solver.setHelmholtzPrec(helmholtz_prec);
-        solver.setOrbitalPrec(start_prec, final_prec);
-        solver.setThreshold(orbital_thrs, energy_thrs);
+        scf::setup_solver(json_scf["scf_solver"], solver);
 
         json_out["scf_solver"] = solver.optimize(mol, F);
         json_out["success"] = json_out["scf_solver"]["converged"];
@@ -310,6 +300,141 @@ json driver::scf::run(const json &json_scf, Molecule &mol) {
     return json_out;
 }
 
+/** @brief Set up the ground state solver from input
+ *
+ * This function expects the "scf_solver" subsection of the input.
+ */
+void driver::scf::setup_solver(const json &json_solver, GroundStateSolver &solver) {
+    auto accelerator = json_solver["accelerator"];
+    auto kain = json_solver["kain"];
+    auto kain_rotation = json_solver["kain_rotation"];
+    auto kain_memory = json_solver["kain_memory"];
+    auto kain_crop_prec = json_solver["kain_crop_prec"];
+    auto kain_path = json_solver["kain_path"];
+    auto method = json_solver["method"];
+    auto relativity = json_solver["relativity"];
+    auto environment = json_solver["environment"];
+    auto external_field = json_solver["external_field"];
+    auto max_iter = json_solver["max_iter"];
+    auto rotation = json_solver["rotation"];
+    auto localize = json_solver["localize"];
+    auto freeze_orbitals = json_solver["freeze_orbitals"];
+    auto orthonormalize_once = json_solver["orthonormalize_once"];
+    auto file_chk = json_solver["file_chk"];
+    auto checkpoint = json_solver["checkpoint"];
+    auto checkpoint_state = json_solver["checkpoint_state"];
+    auto restart_state = json_solver["restart_state"];
+    auto start_prec = json_solver["start_prec"];
+    auto final_prec = json_solver["final_prec"];
+    auto energy_thrs = json_solver["energy_thrs"];
+    auto orbital_thrs = json_solver["orbital_thrs"];
+    auto helmholtz_prec = json_solver["helmholtz_prec"];
+
+    solver.setHistory(kain);
+    solver.setAccelerator(accelerator);
+    solver.setRotateHistory(kain_rotation);
+    solver.setHistoryStorage(kain_memory, kain_crop_prec, kain_path);
+    solver.setRotation(rotation);
+    solver.setLocalize(localize);
+    solver.setFreezeOrbitals(freeze_orbitals);
+    solver.setOrthonormalizeOnce(orthonormalize_once);
+    solver.setMethodName(method);
+    solver.setRelativityName(relativity);
+    solver.setEnvironmentName(environment);
+    solver.setExternalFieldName(external_field);
+    solver.setCheckpoint(checkpoint);
+    solver.setCheckpointFile(file_chk);
+    solver.setCheckpointState(checkpoint_state, restart_state);
+    solver.setMaxIterations(max_iter);
+    solver.setHelmholtzPrec(helmholtz_prec);
+    solver.setOrbitalPrec(start_prec, final_prec);
+    solver.setThreshold(orbital_thrs, energy_thrs);
+}
+
+/** @brief Run the first stage of the SCF with a lower order basis
+ *
+ * The orbitals are transferred to a lower order MRA on the same world
+ * box, and optimized to the start precision of the SCF using a Fock
+ * operator built for this MRA. The early iterations are then done with
+ * the cheaper basis, while the converged orbitals are transferred back
+ * to the final MRA, where the remaining iterations are done. The MRA
+ * transfers are done directly from the orbital trees, no re-projection
+ * of the initial guess is involved.
+ *
+ * The global MRA is temporarily replaced during this stage, since all
+ * operators are constructed from it, and restored when the stage is left. Returns a JSON record of the stage
+ * (cycles and convergence), as for the final stage.
+ *
+ * This function expects the "scf_calculation" subsection of the input.
+ */
+json driver::scf::run_start_order(const json &json_scf, Molecule &mol) {
+    const auto &json_solver = json_scf["scf_solver"];
+    int start_order = json_solver["start_order"];
+    double start_prec = json_solver["start_prec"];
+    double final_prec = json_solver["final_prec"];
+    double orbital_thrs = json_solver["orbital_thrs"];
+    double energy_thrs = json_solver["energy_thrs"];
+
+    // Thresholds are relaxed according to the start precision
+    double thrs_scale = start_prec / final_prec;
+    if (orbital_thrs > 0.0) orbital_thrs *= thrs_scale;
+    if (energy_thrs > 0.0) energy_thrs *= thrs_scale;
+
+    // Lower order MRA with the same world box and basis type
+    auto *mra_final = MRA;
+    std::unique_ptr<mrcpp::MultiResolutionAnalysis<3>> mra_start;
+    const auto &world = mra_final->getWorldBox();
+    int max_depth = mra_final->getMaxDepth();
+    if (mra_final->getScalingBasis().getScalingType() == mrcpp::Interpol) {
+        mrcpp::InterpolatingBasis basis(start_order);
+        mra_start = std::make_unique<mrcpp::MultiResolutionAnalysis<3>>(world, basis, max_depth);
+    } else {
+        mrcpp::LegendreBasis basis(start_order);
+        mra_start = std::make_unique<mrcpp::MultiResolutionAnalysis<3>>(world, basis, max_depth);
+    }
+
+    // Restores the final MRA when leaving this stage, also if an exception is
+    // thrown, before the lower order MRA is released
+    struct RestoreMRA {
+        mrcpp::MultiResolutionAnalysis<3> *mra;
+        ~RestoreMRA() {
+            MRA = mra;
+            mrcpp::cplxfunc::SetdefaultMRA(MRA);
+            HelmholtzVector::clearCache();
+        }
+    } restore_mra{mra_final};
+
+    mrcpp::print::separator(0, '~');
+    print_utils::text(0, "Calculation    ", "Optimize with lower order basis");
+    print_utils::text(0, "Basis order    ", std::to_string(start_order));
+    print_utils::text(0, "Precision      ", print_utils::dbl_to_str(start_prec, 5, true));
+    mrcpp::print::separator(0, '~', 2);
+
+    auto &Phi = mol.getOrbitals();
+    Phi = orbital::change_mra(Phi, *mra_start, start_prec);
+    MRA = mra_start.get();
+    mrcpp::cplxfunc::SetdefaultMRA(MRA);
+    HelmholtzVector::clearCache();
+
+    json json_start;
+    {
+        FockBuilder F;
+        driver::build_fock_operator(json_scf["fock_operator"], mol, F, 0);
+        if (F.getExchangeOperator()) F.getExchangeOperator()->setPreCompute();
+
+        GroundStateSolver solver;
+        scf::setup_solver(json_solver, solver);
+        solver.setCheckpoint(false);
+        solver.setCheckpointState(false, false);
+        solver.setOrbitalPrec(start_prec, start_prec);
+        solver.setThreshold(orbital_thrs, energy_thrs);
+        json_start = solver.optimize(mol, F);
+    }
+
+    Phi = orbital::change_mra(Phi, *mra_final, start_prec);
+    return json_start;
+}
+
 /** @brief Run initial guess calculation for the orbitals
  *
  * This function will update the ground state orbitals and the Fock
@@ -400,7 +525,8 @@ bool driver::scf::guess_energy(const json &json_guess, Molecule &mol, FockBuilde
     auto relativity = json_guess["relativity"];
     auto environment = json_guess["environment"];
     auto external_field = json_guess["external_field"];
-    auto localize = json_guess["localize"];
+    bool localize = json_guess["localize"];
+    bool rotate = json_guess["rotate"];
 
     mrcpp::print::separator(0, '~');
     print_utils::text(0, "Calculation    ", "Compute initial energy");
@@ -409,7 +535,7 @@ bool driver::scf::guess_energy(const json &json_guess, Molecule &mol, FockBuilde
     print_utils::text(0, "Environment    ", environment);
     print_utils::text(0, "External fields", external_field);
     print_utils::text(0, "Precision      ", print_utils::dbl_to_str(prec, 5, true));
-    print_utils::text(0, "Localization   ", (localize) ? "On" : "Off");
+    print_utils::text(0, "Localization   ", (not rotate) ? "Skipped" : (localize) ? "On" : "Off");
     mrcpp::print::separator(0, '~', 2);
 
     Timer t_scf;
@@ -421,8 +547,9 @@ bool driver::scf::guess_energy(const json &json_guess, Molecule &mol, FockBuilde
     auto &F_mat = mol.getFockMatrix();
     Phi.distribute();
     F_mat = ComplexMatrix::Zero(Phi.size(), Phi.size());
-    if (localize) orbital::localize(prec, Phi, F_mat);
-    else orbital::diagonalize(prec, Phi, F_mat);
+    // A restarted solver state holds history in the basis of the checkpoint orbitals
+    if (rotate and localize) orbital::localize(prec, Phi, F_mat);
+    if (rotate and not localize) orbital::diagonalize(prec, Phi, F_mat);
 
     F.setup(prec);
     F_mat = F(Phi, Phi);
@@ -740,17 +867,37 @@ json driver::rsp::run(const json &json_rsp, Molecule &mol) {
 
     auto omega = json_rsp["frequency"];
     auto dynamic = json_rsp["dynamic"];
-    mol.initPerturbedOrbitals(dynamic);
-
-    FockBuilder F_1;
-    const auto &json_fock_1 = json_rsp["fock_operator"];
-    driver::build_fock_operator(json_fock_1, mol, F_1, 1);
+    auto batch_components = json_rsp["batch_components"];
 
     const auto &json_pert = json_rsp["perturbation"];
     auto h_1 = driver::get_operator<3>(json_pert["operator"], json_pert);
     json_out["perturbation"] = json_pert["operator"];
     json_out["frequency"] = omega;
     json_out["components"] = {};
+
+    // Optimize a list of frequencies, each starting from the previous solutions
+    if (json_rsp.contains("frequencies")) {
+        if (batch_components) MSG_ABORT("Frequency sweep cannot be combined with batched components");
+        json_out["success"] = rsp::run_sweep(json_rsp, mol, F_0, h_1, json_out);
+        F_0.clear();
+        mrcpp::mpi::barrier(mrcpp::mpi::comm_wrk);
+        return json_out;
+    }
+
+    // Optimize all components simultaneously
+    if (batch_components) {
+        json_out["success"] = rsp::run_batched(json_rsp, mol, F_0, h_1, json_out);
+        F_0.clear();
+        mrcpp::mpi::barrier(mrcpp::mpi::comm_wrk);
+        return json_out;
+    }
+
+    mol.initPerturbedOrbitals(dynamic);
+
+    FockBuilder F_1;
+    const auto &json_fock_1 = json_rsp["fock_operator"];
+    driver::build_fock_operator(json_fock_1, mol, F_1, 1);
+
     for (auto d = 0; d < 3; d++) {
         json comp_out = {};
         const auto &json_comp = json_rsp["components"][d];
@@ -768,29 +915,8 @@ json driver::rsp::run(const json &json_rsp, Molecule &mol) {
         ///////////////////////////////////////////////////////////
 
         if (json_comp.contains("rsp_solver")) {
-            auto kain = json_comp["rsp_solver"]["kain"];
-            auto method = json_comp["rsp_solver"]["method"];
-            auto max_iter = json_comp["rsp_solver"]["max_iter"];
-            auto file_chk_x = json_comp["rsp_solver"]["file_chk_x"];
-            auto file_chk_y = json_comp["rsp_solver"]["file_chk_y"];
-            auto checkpoint = json_comp["rsp_solver"]["checkpoint"];
-            auto orth_prec = json_comp["rsp_solver"]["orth_prec"];
-            auto start_prec = json_comp["rsp_solver"]["start_prec"];
-            auto final_prec = json_comp["rsp_solver"]["final_prec"];
-            auto orbital_thrs = json_comp["rsp_solver"]["orbital_thrs"];
-            auto property_thrs = json_comp["rsp_solver"]["property_thrs"];
-            auto helmholtz_prec = json_comp["rsp_solver"]["helmholtz_prec"];
-
             LinearResponseSolver solver(dynamic);
-            solver.setHistory(kain);
-            solver.setMethodName(method);
-            solver.setMaxIterations(max_iter);
-            solver.setCheckpoint(checkpoint);
-            solver.setCheckpointFile(file_chk_x, file_chk_y);
-            solver.setHelmholtzPrec(helmholtz_prec);
-            solver.setOrbitalPrec(start_prec, final_prec);
-            solver.setThreshold(orbital_thrs, property_thrs);
-            solver.setOrthPrec(orth_prec);
+            rsp::setup_solver(json_comp["rsp_solver"], solver);
 
             comp_out["rsp_solver"] = solver.optimize(omega, mol, F_0, F_1);
             json_out["success"] = comp_out["rsp_solver"]["converged"];
@@ -816,6 +942,258 @@ json driver::rsp::run(const json &json_rsp, Molecule &mol) {
     return json_out;
 }
 
+/** @brief Run linear response calculation for all components simultaneously
+ *
+ * Same as the component loop in rsp::run, but all components with a solver
+ * section are optimized together by a single LinearResponseSolver, which
+ * shares the unperturbed potential and Helmholtz operators between them.
+ * Each component gets its own perturbed orbitals and perturbed Fock operator,
+ * where the perturbed XC operators share the XC kernel and unperturbed density.
+ * The solver parameters are taken from the first optimized component.
+ * Returns success of all components, the output of each component is added
+ * to the "components" list of the output JSON.
+ *
+ * This function expects the "rsp_calculation" subsection of the input.
+ */
+bool driver::rsp::run_batched(const json &json_rsp, Molecule &mol, FockBuilder &F_0, RankOneOperator<3> &h_1, json &json_out) {
+    auto omega = json_rsp["frequency"];
+    auto dynamic = json_rsp["dynamic"];
+    const auto &json_fock_1 = json_rsp["fock_operator"];
+
+    std::vector<std::unique_ptr<FockBuilder>> F_1;
+    std::vector<std::shared_ptr<OrbitalVector>> X_p, Y_p;
+    std::vector<ResponseComponent> comps;
+    std::vector<int> comp_idx;
+    std::vector<bool> success;
+    std::vector<json> comp_out;
+    for (auto d = 0; d < 3; d++) {
+        const auto &json_comp = json_rsp["components"][d];
+        mol.initPerturbedOrbitals(dynamic);
+        X_p.push_back(mol.getOrbitalsX_p());
+        Y_p.push_back(mol.getOrbitalsY_p());
+
+        // The XC kernel and unperturbed density are shared by all components
+        F_1.push_back(std::make_unique<FockBuilder>());
+        XCOperator *xc_ref = (d > 0) ? F_1[0]->getXCOperator().get() : nullptr;
+        driver::build_fock_operator(json_fock_1, mol, *F_1[d], 1, xc_ref);
+        F_1[d]->perturbation() = h_1[d];
+
+        const auto &json_guess = json_comp["initial_guess"];
+        success.push_back(rsp::guess_orbitals(json_guess, mol));
+        comp_out.push_back({});
+
+        if (json_comp.contains("rsp_solver")) {
+            ResponseComponent comp;
+            comp.F_1 = F_1[d].get();
+            comp.X = X_p[d];
+            comp.Y = Y_p[d];
+            comp.chkFileX = json_comp["rsp_solver"]["file_chk_x"];
+            comp.chkFileY = json_comp["rsp_solver"]["file_chk_y"];
+            comps.push_back(comp);
+            comp_idx.push_back(d);
+        }
+    }
+
+    if (not comps.empty()) {
+        LinearResponseSolver solver(dynamic);
+        rsp::setup_solver(json_rsp["components"][comp_idx[0]]["rsp_solver"], solver);
+
+        auto solver_out = solver.optimize(omega, mol, F_0, comps);
+        for (int k = 0; k < comp_idx.size(); k++) {
+            auto d = comp_idx[k];
+            comp_out[d]["rsp_solver"] = solver_out["components"][k];
+            success[d] = comp_out[d]["rsp_solver"]["converged"].get<bool>();
+        }
+    }
+
+    bool all_success = true;
+    for (auto d = 0; d < 3; d++) {
+        const auto &json_comp = json_rsp["components"][d];
+        mol.setPerturbedOrbitals(X_p[d], Y_p[d]);
+        if (success[d]) {
+            if (json_comp.contains("write_orbitals")) rsp::write_orbitals(json_comp["write_orbitals"], mol, dynamic);
+            if (json_rsp.contains("properties")) rsp::calc_properties(json_rsp["properties"], mol, d, omega);
+        }
+        mol.getOrbitalsX().clear(); // Clear orbital vector
+        mol.getOrbitalsY().clear(); // Clear orbital vector
+        json_out["components"].push_back(comp_out[d]);
+        all_success = (all_success and success[d]);
+    }
+    mol.getOrbitalsX_p().reset(); // Release shared_ptr
+    mol.getOrbitalsY_p().reset(); // Release shared_ptr
+
+    return all_success;
+}
+
+/** @brief Run linear response calculations for a list of frequencies
+ *
+ * The frequencies are computed in the given order, while the unperturbed Fock
+ * operator is kept throughout. The response orbitals of each frequency are
+ * started from the converged solutions at the previous frequencies (see
+ * extrapolate_orbitals), the initial guess of the input is only used for the
+ * first frequency. The perturbed Fock operator is only rebuilt when switching
+ * between static and dynamic response, where the Y orbitals are either shared
+ * with X or separate. Response orbitals are written for the last frequency.
+ *
+ * Returns success of all frequencies, the output of each frequency is added
+ * to the "sweep" list of the output JSON.
+ *
+ * This function expects the "rsp_calculation" subsection of the input.
+ */
+bool driver::rsp::run_sweep(const json &json_rsp, Molecule &mol, FockBuilder &F_0, RankOneOperator<3> &h_1, json &json_out) {
+    auto frequencies = json_rsp["frequencies"].get<std::vector<double>>();
+    const auto &json_fock_1 = json_rsp["fock_operator"];
+    json_out["frequencies"] = frequencies;
+    json_out["sweep"] = {};
+
+    // Converged solutions at the (at most) two previous frequencies
+    std::vector<double> omega_prev;
+    std::vector<std::vector<OrbitalVector>> X_prev(3), Y_prev(3);
+
+    bool all_success = true;
+    bool dynamic = false;
+    std::unique_ptr<FockBuilder> F_1;
+    for (int n = 0; n < frequencies.size(); n++) {
+        double omega = frequencies[n];
+        bool last = (n == frequencies.size() - 1);
+        if (F_1 == nullptr or dynamic != (omega > 1.0e-12)) {
+            dynamic = (omega > 1.0e-12);
+            mol.initPerturbedOrbitals(dynamic);
+            F_1 = std::make_unique<FockBuilder>();
+            driver::build_fock_operator(json_fock_1, mol, *F_1, 1);
+        }
+
+        // Only the polarizabilities of the current frequency are computed
+        json json_prop = {};
+        if (json_rsp.contains("properties")) json_prop = json_rsp["properties"];
+        if (json_prop.contains("polarizability")) {
+            json json_pol = {};
+            for (const auto &item : json_rsp["properties"]["polarizability"].items()) {
+                double freq = item.value()["frequency"];
+                if (std::abs(freq - omega) < mrcpp::MachineZero) json_pol[item.key()] = item.value();
+            }
+            json_prop["polarizability"] = json_pol;
+        }
+
+        bool freq_success = true;
+        json freq_out = {{"frequency", omega}};
+        freq_out["components"] = {};
+        for (auto d = 0; d < 3; d++) {
+            json comp_out = {};
+            const auto &json_comp = json_rsp["components"][d];
+            F_1->perturbation() = h_1[d];
+
+            bool success = true;
+            if (omega_prev.empty()) {
+                success = rsp::guess_orbitals(json_comp["initial_guess"], mol);
+            } else {
+                rsp::extrapolate_orbitals(omega, omega_prev, X_prev[d], Y_prev[d], mol);
+            }
+
+            if (json_comp.contains("rsp_solver")) {
+                LinearResponseSolver solver(dynamic);
+                rsp::setup_solver(json_comp["rsp_solver"], solver);
+
+                comp_out["rsp_solver"] = solver.optimize(omega, mol, F_0, *F_1);
+                success = comp_out["rsp_solver"]["converged"];
+            }
+
+            if (success) {
+                if (last and json_comp.contains("write_orbitals")) rsp::write_orbitals(json_comp["write_orbitals"], mol, dynamic);
+                if (not json_prop.empty()) rsp::calc_properties(json_prop, mol, d, omega);
+            }
+
+            // Keep solution as starting point for the next frequency
+            X_prev[d].push_back(mol.getOrbitalsX());
+            Y_prev[d].push_back(mol.getOrbitalsY());
+            if (X_prev[d].size() > 2) X_prev[d].erase(X_prev[d].begin());
+            if (Y_prev[d].size() > 2) Y_prev[d].erase(Y_prev[d].begin());
+            mol.getOrbitalsX().clear(); // Clear orbital vector
+            mol.getOrbitalsY().clear(); // Clear orbital vector
+
+            freq_out["components"].push_back(comp_out);
+            freq_success = (freq_success and success);
+        }
+        omega_prev.push_back(omega);
+        if (omega_prev.size() > 2) omega_prev.erase(omega_prev.begin());
+
+        freq_out["success"] = freq_success;
+        all_success = (all_success and freq_success);
+        json_out["sweep"].push_back(freq_out);
+    }
+    mol.getOrbitalsX_p().reset(); // Release shared_ptr
+    mol.getOrbitalsY_p().reset(); // Release shared_ptr
+
+    return all_success;
+}
+
+/** @brief Set up response orbitals from the solutions at previous frequencies
+ *
+ * @param omega: frequency of the new response orbitals
+ * @param omega_prev: previous frequencies, the latest last
+ * @param X_prev: converged X orbitals at the previous frequencies
+ * @param Y_prev: converged Y orbitals at the previous frequencies
+ *
+ * With two previous solutions the orbitals are extrapolated linearly in the
+ * frequency, x(w) = x_1 + (w - w_1)/(w_1 - w_0) * (x_1 - x_0), otherwise the
+ * latest solution is copied. Y orbitals are only set up for dynamic response,
+ * for static response they are the same as X.
+ */
+void driver::rsp::extrapolate_orbitals(double omega, const std::vector<double> &omega_prev, std::vector<OrbitalVector> &X_prev, std::vector<OrbitalVector> &Y_prev, Molecule &mol) {
+    auto &X = mol.getOrbitalsX();
+    auto &Y = mol.getOrbitalsY();
+
+    int n = omega_prev.size();
+    double w_0 = (n > 1) ? omega_prev[n - 2] : 0.0;
+    double w_1 = omega_prev[n - 1];
+    bool extrapolate = (n > 1 and std::abs(w_1 - w_0) > mrcpp::MachineZero);
+
+    mrcpp::print::separator(0, '~');
+    print_utils::text(0, "Calculation     ", "Compute initial orbitals");
+    print_utils::text(0, "Method          ", (extrapolate) ? "Extrapolated from previous frequencies" : "Copied from previous frequency");
+    mrcpp::print::separator(0, '~', 2);
+
+    if (extrapolate) {
+        double t = (omega - w_1) / (w_1 - w_0);
+        X = orbital::add(1.0 + t, X_prev[n - 1], -t, X_prev[n - 2]);
+        if (&X != &Y) Y = orbital::add(1.0 + t, Y_prev[n - 1], -t, Y_prev[n - 2]);
+    } else {
+        X = orbital::deep_copy(X_prev[n - 1]);
+        if (&X != &Y) Y = orbital::deep_copy(Y_prev[n - 1]);
+    }
+    orbital::print(X);
+    if (&X != &Y) orbital::print(Y);
+}
+
+/** @brief Set up the linear response solver from input
+ *
+ * This function expects the "rsp_solver" subsection of the input.
+ */
+void driver::rsp::setup_solver(const json &json_solver, LinearResponseSolver &solver) {
+    auto kain = json_solver["kain"];
+    auto method = json_solver["method"];
+    auto max_iter = json_solver["max_iter"];
+    auto file_chk_x = json_solver["file_chk_x"];
+    auto file_chk_y = json_solver["file_chk_y"];
+    auto checkpoint = json_solver["checkpoint"];
+    auto orth_prec = json_solver["orth_prec"];
+    auto start_prec = json_solver["start_prec"];
+    auto final_prec = json_solver["final_prec"];
+    auto orbital_thrs = json_solver["orbital_thrs"];
+    auto property_thrs = json_solver["property_thrs"];
+    auto helmholtz_prec = json_solver["helmholtz_prec"];
+
+    solver.setHistory(kain);
+    solver.setMethodName(method);
+    solver.setMaxIterations(max_iter);
+    solver.setCheckpoint(checkpoint);
+    solver.setCheckpointFile(file_chk_x, file_chk_y);
+    solver.setHelmholtzPrec(helmholtz_prec);
+    solver.setOrbitalPrec(start_prec, final_prec);
+    solver.setThreshold(orbital_thrs, property_thrs);
+    solver.setOrthPrec(orth_prec);
+}
+
 /** @brief Run initial guess calculation for the response orbitals
  *
  * This function will update the ground state orbitals and the Fock
@@ -953,8 +1331,41 @@ void driver::rsp::calc_properties(const json &json_prop, Molecule &mol, int dir,
     if (json_prop.contains("nmr_shielding")) {
         t_lap.start();
         mrcpp::print::header(2, "Computing NMR shielding (para)");
+        // Shieldings with the h_m_pso operator can be computed for all nuclei at once,
+        // provided they share the same precision, smoothing and derivative
+        auto is_batched = [](const json &json_nmr) {
+            if (not json_nmr.contains("batch") or not json_nmr["batch"].get<bool>()) return false;
+            return (json_nmr["para_operator"] == "h_m_pso");
+        };
+        std::vector<std::string> batch_ids;
+        std::vector<mrcpp::Coord<3>> batch_nucs;
+        for (const auto &item : json_prop["nmr_shielding"].items()) {
+            if (not is_batched(item.value())) continue;
+            batch_ids.push_back(item.key());
+            batch_nucs.push_back(item.value()["r_K"].get<mrcpp::Coord<3>>());
+        }
+        if (batch_ids.size() > 0) {
+            const auto &json_batch = json_prop["nmr_shielding"][batch_ids[0]];
+            for (const auto &id : batch_ids) {
+                const auto &json_nmr = json_prop["nmr_shielding"][id];
+                if (json_nmr["precision"] != json_batch["precision"]) MSG_ABORT("Batched NMR shieldings differ in precision");
+                if (json_nmr["smoothing"] != json_batch["smoothing"]) MSG_ABORT("Batched NMR shieldings differ in smoothing");
+                if (json_nmr["derivative"] != json_batch["derivative"]) MSG_ABORT("Batched NMR shieldings differ in derivative");
+            }
+            double prec = json_batch["precision"];
+            double smooth = json_batch["smoothing"];
+            MomentumOperator p(driver::get_derivative(json_batch["derivative"]));
+            p.setup(prec);
+            ComplexMatrix traces = qmoperator::calc_pso_trace(p, batch_nucs, prec, smooth, Phi, X, Y);
+            p.clear();
+            for (int k = 0; k < batch_ids.size(); k++) {
+                NMRShielding &sigma = mol.getNMRShielding(batch_ids[k]);
+                sigma.getParamagnetic().row(dir) = -traces.row(k).real();
+            }
+        }
         for (const auto &item : json_prop["nmr_shielding"].items()) {
             const auto &id = item.key();
+            if (is_batched(item.value())) continue;
             const auto &prec = item.value()["precision"];
             const auto &oper_name = item.value()["para_operator"];
             auto h = driver::get_operator<3>(oper_name, item.value());
@@ -979,9 +1390,11 @@ void driver::rsp::calc_properties(const json &json_prop, Molecule &mol, int dir,
  *
  * This function expects the "fock_operator" subsection of input, and will
  * construct all operator which are present in this input. Option to set
- * perturbation order of the operators.
+ * perturbation order of the operators. For perturbation order 1, an existing
+ * XC operator can be given, with which the new XC operator will share the
+ * XC kernel and the unperturbed density.
  */
-void driver::build_fock_operator(const json &json_fock, Molecule &mol, FockBuilder &F, int order) {
+void driver::build_fock_operator(const json &json_fock, Molecule &mol, FockBuilder &F, int order, XCOperator *xc_ref) {
     auto &nuclei = mol.getNuclei();
     auto Phi_p = mol.getOrbitals_p();
     auto X_p = mol.getOrbitalsX_p();
@@ -1072,6 +1485,7 @@ void driver::build_fock_operator(const json &json_fock, Molecule &mol, FockBuild
         auto json_xcfunc = json_fock["xc_operator"]["xc_functional"];
         auto xc_spin = json_xcfunc["spin"];
         auto xc_cutoff = json_xcfunc["cutoff"];
+        auto xc_diff = json_xcfunc["derivative"];
         auto xc_funcs = json_xcfunc["functionals"];
         auto xc_order = order + 1;
 
@@ -1079,6 +1493,7 @@ void driver::build_fock_operator(const json &json_fock, Molecule &mol, FockBuild
         xc_factory.setSpin(xc_spin);
         xc_factory.setOrder(xc_order);
         xc_factory.setDensityCutoff(xc_cutoff);
+        xc_factory.setDerivative(xc_diff);
         for (const auto &f : xc_funcs) {
             auto name = f["name"];
             auto coef = f["coef"];
@@ -1090,6 +1505,9 @@ void driver::build_fock_operator(const json &json_fock, Molecule &mol, FockBuild
         if (order == 0) {
             auto XC_p = std::make_shared<XCOperator>(mrdft_p, Phi_p, shared_memory);
             F.getXCOperator() = XC_p;
+        } else if (order == 1 and xc_ref != nullptr) {
+            auto XC_p = std::make_shared<XCOperator>(*xc_ref, X_p, Y_p);
+            F.getXCOperator() = XC_p;
         } else if (order == 1) {
             auto XC_p = std::make_shared<XCOperator>(mrdft_p, Phi_p, X_p, Y_p, shared_memory);
             F.getXCOperator() = XC_p;
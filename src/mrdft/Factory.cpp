@@ -25,6 +25,8 @@
 
 #include "Factory.h"
 
+#include <algorithm>
+
 #include <MRCPP/MWOperators>
 #include <MRCPP/Printer>
 #include <XCFun/xcfun.h>
@@ -42,6 +44,29 @@ Factory::Factory(const mrcpp::MultiResolutionAnalysis<3> &MRA)
         : mra(MRA)
         , xcfun_p(xcfun_new(), xcfun_delete) {}
 
+/** @brief Add a functional to the XCFun object
+ *
+ * Keeps track of the Slater exchange and VWN5 correlation contributions
+ * (also through the XCFun aliases), which can be evaluated with native
+ * kernels if no other functionals are present.
+ */
+void Factory::setFunctional(const std::string &n, double c) {
+    xcfun_set(xcfun_p.get(), n.c_str(), c);
+
+    std::string name = n;
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if (name == "slaterx") {
+        slater_coef += c;
+    } else if (name == "vwn5c") {
+        vwn5_coef += c;
+    } else if (name == "svwn5" or name == "lda") {
+        slater_coef += c;
+        vwn5_coef += c;
+    } else {
+        has_other = true;
+    }
+}
+
 /** @brief Build a MRDFT object from the currently defined parameters */
 std::unique_ptr<MRDFT> Factory::build() {
     // Init DFT grid
@@ -65,6 +90,7 @@ std::unique_ptr<MRDFT> Factory::build() {
         if (diff_s == "bspline") diff_p = std::make_unique<mrcpp::BSOperator<3>>(mra, 1);
         if (diff_s == "abgv_00") diff_p = std::make_unique<mrcpp::ABGVOperator<3>>(mra, 0.0, 0.0);
         if (diff_s == "abgv_55") diff_p = std::make_unique<mrcpp::ABGVOperator<3>>(mra, 0.5, 0.5);
+        if (diff_s != "local" and diff_p == nullptr) MSG_ABORT("Invalid derivative operator: " << diff_s);
     }
 
     // Init XC functional
@@ -78,7 +104,9 @@ std::unique_ptr<MRDFT> Factory::build() {
     }
     if (func_p == nullptr) MSG_ABORT("Invalid functional type");
     func_p->setLogGradient(log_grad);
+    if (gga and diff_s == "local") func_p->setLocalGradient(true);
     func_p->setDensityCutoff(cutoff);
+    if (use_native and lda and not spin and not has_other and order <= 2) func_p->setNativeLDA(slater_coef, vwn5_coef);
 
     auto mrdft_p = std::make_unique<MRDFT>(grid_p, func_p);
     return mrdft_p;
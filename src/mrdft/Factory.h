@@ -43,7 +43,8 @@ public:
     void setLogGradient(bool lg) { log_grad = lg; }
     void setDensityCutoff(double c) { cutoff = c; }
     void setDerivative(const std::string &n) { diff_s = n; }
-    void setFunctional(const std::string &n, double c = 1.0) { xcfun_set(xcfun_p.get(), n.c_str(), c); }
+    void setFunctional(const std::string &n, double c = 1.0);
+    void setUseNative(bool n) { use_native = n; }
 
     std::unique_ptr<MRDFT> build();
 
@@ -52,7 +53,11 @@ private:
     bool spin{false};
     bool gamma{false};
     bool log_grad{false};
+    bool use_native{true};
     double cutoff{-1.0};
+    double slater_coef{0.0};
+    double vwn5_coef{0.0};
+    bool has_other{false}; ///< Functionals without native kernels
     std::string diff_s{"abgv_00"};
     const mrcpp::MultiResolutionAnalysis<3> mra;
 
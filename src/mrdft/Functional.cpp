@@ -23,26 +23,56 @@
  * <https://mrchem.readthedocs.io/>
  */
 
+#include <vector>
+
 #include <MRCPP/Printer>
 
 #include "Functional.h"
+#include "xc_kernels.h"
+#include "xc_utils.h"
 
 namespace mrdft {
 
+/** @brief Use native kernels instead of XCFun
+ *
+ * Only available for spin-restricted LDA functionals that are a combination
+ * of Slater exchange and VWN5 correlation, up to second order.
+ *
+ * param[in] c_x Coefficient of Slater exchange
+ * param[in] c_c Coefficient of VWN5 correlation
+ */
+void Functional::setNativeLDA(double c_x, double c_c) {
+    if (isSpin() or not isLDA()) MSG_ABORT("Native kernels only available for spin-restricted LDA");
+    if (order > 2) MSG_ABORT("Native kernels only available up to second order");
+    native_lda = true;
+    slater_coef = c_x;
+    vwn5_coef = c_c;
+}
+
 /** @brief Run a collection of grid points through XCFun
  *
- * Each row corresponds to one grid point.
+ * Each column corresponds to one grid point.
+ *
+ * Points where the density is below the cutoff are screened away before
+ * entering XCFun and get zero output. The remaining points are packed
+ * into a contiguous buffer and evaluated in a single call to the
+ * vectorized XCFun interface. If no points are screened, the input
+ * matrix is passed directly without any intermediate copy.
  *
- * param[in] inp_data Matrix of input values
- * param[out] out_data Matrix of output values
+ * param[in] inp Matrix of input values
+ * param[out] out Matrix of output values
+ * param[inout] buf Work buffers for the packed points
  */
-Eigen::MatrixXd Functional::evaluate(Eigen::MatrixXd &inp) const {
+void Functional::evaluate(const Eigen::MatrixXd &inp, Eigen::MatrixXd &out, NodeBuffers &buf) const {
     int nInp = xcfun_input_length(xcfun.get());  // Input parameters to XCFun
-    int nOut = xcfun_output_length(xcfun.get()); // Input parameters to XCFun
+    int nOut = xcfun_output_length(xcfun.get()); // Output parameters from XCFun
     int nPts = inp.cols();
     if (nInp != inp.rows()) MSG_ABORT("Invalid input");
 
-    Eigen::MatrixXd out = Eigen::MatrixXd::Zero(nOut, nPts);
+    // Collect the points that are above the density cutoff
+    auto &calc_pts = buf.calcPts;
+    calc_pts.clear();
+    calc_pts.reserve(nPts);
     for (int i = 0; i < nPts; i++) {
         bool calc = true;
         if (isSpin()) {
@@ -50,41 +80,145 @@ Eigen::MatrixXd Functional::evaluate(Eigen::MatrixXd &inp) const {
         } else {
             if (inp(0, i) < cutoff) calc = false;
         }
-        if (calc) xcfun_eval(xcfun.get(), inp.col(i).data(), out.col(i).data());
+        if (calc) calc_pts.push_back(i);
+    }
+    int nCalc = calc_pts.size();
+
+    out.resize(nOut, nPts);
+    out.setZero();
+    if (nCalc == nPts) {
+        // No screening: evaluate directly on the (column-major) input
+        evaluate_vec(nPts, inp.data(), nInp, out.data(), nOut);
+    } else if (nCalc > 0) {
+        // Pack the remaining points, evaluate and scatter back. The packed
+        // buffers have room for all points, so their size never changes
+        buf.calcInp.resize(nInp, nPts);
+        buf.calcOut.resize(nOut, nPts);
+        buf.calcOut.leftCols(nCalc).setZero();
+        for (int j = 0; j < nCalc; j++) buf.calcInp.col(j) = inp.col(calc_pts[j]);
+        evaluate_vec(nCalc, buf.calcInp.data(), nInp, buf.calcOut.data(), nOut);
+        for (int j = 0; j < nCalc; j++) out.col(calc_pts[j]) = buf.calcOut.col(j);
+    }
+}
+
+/** @brief Evaluate the functional on a contiguous array of points
+ *
+ * Uses the native LDA kernels if enabled, otherwise the vectorized
+ * XCFun interface. The output array must be zero on entry.
+ *
+ * param[in] nPts Number of grid points
+ * param[in] inp Input values, inp_pitch values per point
+ * param[out] out Output values, out_pitch values per point
+ */
+void Functional::evaluate_vec(int nPts, const double *inp, int inp_pitch, double *out, int out_pitch) const {
+    if (native_lda) {
+        if (inp_pitch != 1) MSG_ABORT("Invalid input");
+        if (std::abs(slater_coef) > 0.0) xc_kernels::slater_x(order, nPts, inp, out, out_pitch, slater_coef);
+        if (std::abs(vwn5_coef) > 0.0) xc_kernels::vwn5_c(order, nPts, inp, out, out_pitch, vwn5_coef);
+    } else {
+        xcfun_eval_vec(xcfun.get(), nPts, inp, inp_pitch, out, out_pitch);
     }
-    return out;
 }
 
 /** @brief Contract a collection of grid points
  *
- * Each row corresponds to one grid point.
+ * Each column corresponds to one grid point.
  *
  * param[in] xc_data Matrix of functional partial derivative values
  * param[in] d_data Matrix of density input values
  * param[out] out_data Matrix of contracted output values
  */
-Eigen::MatrixXd Functional::contract(Eigen::MatrixXd &xc_data, Eigen::MatrixXd &d_data) const {
+void Functional::contract(const Eigen::MatrixXd &xc_data, const Eigen::MatrixXd &d_data, Eigen::MatrixXd &out_data) const {
     auto nPts = xc_data.cols();
     auto nFcs = getCtrOutputLength();
-    Eigen::MatrixXd out_data = Eigen::MatrixXd::Zero(nFcs, nPts);
+    out_data.resize(nFcs, nPts);
     out_data.row(0) = xc_data.row(0); // we always keep the energy functional
 
     for (int i = 0; i < this->xc_mask.rows(); i++) {
-        Eigen::VectorXd cont_i = Eigen::VectorXd::Zero(nPts);
+        auto cont_i = out_data.row(i + 1); // The first row contains the energy functional
+        cont_i.setZero();
         for (int j = 0; j < this->xc_mask.cols(); j++) {
-            Eigen::VectorXd cont_ij = Eigen::VectorXd::Zero(nPts);
             int xc_idx = this->xc_mask(i, j);
             int d_idx = this->d_mask(j);
             if (d_idx >= 0) {
-                cont_ij = xc_data.row(xc_idx).array() * d_data.row(d_idx).array();
+                cont_i.array() += xc_data.row(xc_idx).array() * d_data.row(d_idx).array();
             } else {
-                cont_ij = xc_data.row(xc_idx);
+                cont_i += xc_data.row(xc_idx);
             }
-            cont_i += cont_ij;
         }
-        out_data.row(i + 1) = cont_i; // The first column contains the energy functional
     }
-    return out_data;
+}
+
+/** @brief Number of output functions stored on the grid
+ *
+ * With node local gradients the divergence terms are already included
+ * in the potentials, which leaves only the energy density and one
+ * potential per density.
+ */
+int Functional::getNodeOutputLength() const {
+    if (not local_grad) return getCtrOutputLength();
+    return (isSpin()) ? 3 : 2;
+}
+
+/** @brief Add node local density gradients to the input data
+ *
+ * For GGA : [rho] -> [rho, grad(rho)]
+ * For SpinGGA : [alpha, beta] -> [alpha, beta, grad(alpha), grad(beta)]
+ *
+ * param[in] inp_data Matrix of density values, one row per density
+ * param[in] h Side lengths of the child cells of the node
+ * param[in] use_log Use log parametrization for the gradient
+ * param[out] out_data Matrix of densities and gradients
+ * param[inout] buf Work buffers for single functions
+ */
+void Functional::localInput(const Eigen::MatrixXd &inp_data, const std::array<double, 3> &h, bool use_log, Eigen::MatrixXd &out_data, NodeBuffers &buf) const {
+    auto nDens = inp_data.rows();
+    auto nPts = inp_data.cols();
+    out_data.resize(4 * nDens, nPts);
+    out_data.topRows(nDens) = inp_data;
+    for (int i = 0; i < nDens; i++) {
+        buf.values = inp_data.row(i).transpose();
+        if (use_log) {
+            for (int j = 0; j < nPts; j++) buf.values(j) = (inp_data(i, j) > mrcpp::MachineZero) ? std::log(inp_data(i, j)) : mrcpp::MachineZero;
+        }
+        for (int d = 0; d < 3; d++) {
+            xc_utils::local_derivative(local_D, h, buf.values, buf.deriv, d);
+            if (use_log) {
+                out_data.row(nDens + 3 * i + d) = buf.deriv.transpose().cwiseProduct(inp_data.row(i));
+            } else {
+                out_data.row(nDens + 3 * i + d) = buf.deriv.transpose();
+            }
+        }
+    }
+}
+
+/** @brief Combine contracted output into potentials node by node
+ *
+ * For GGA:
+ * f_xc       : out[0] = inp[0]
+ * df_xc/drho : out[1] = inp[1] - div(inp[2,3,4])
+ *
+ * For SpinGGA:
+ * f_xc         : out[0] = inp[0]
+ * df_xc/drho_a : out[1] = inp[1] - div(inp[3,4,5])
+ * df_xc/drho_b : out[2] = inp[2] - div(inp[6,7,8])
+ *
+ * param[in] out_data Matrix of contracted output values
+ * param[in] h Side lengths of the child cells of the node
+ * param[out] pot_data Matrix of energy density and potential values
+ * param[inout] buf Work buffers for single functions
+ */
+void Functional::localOutput(const Eigen::MatrixXd &out_data, const std::array<double, 3> &h, Eigen::MatrixXd &pot_data, NodeBuffers &buf) const {
+    auto nDens = (isSpin()) ? 2 : 1;
+    if (out_data.rows() != 1 + 4 * nDens) MSG_ABORT("Invalid input");
+    pot_data = out_data.topRows(1 + nDens);
+    for (int i = 0; i < nDens; i++) {
+        for (int d = 0; d < 3; d++) {
+            buf.values = out_data.row(1 + nDens + 3 * i + d).transpose();
+            xc_utils::local_derivative(local_D, h, buf.values, buf.deriv, d);
+            pot_data.row(1 + i) -= buf.deriv.transpose();
+        }
+    }
 }
 
 } // namespace mrdft
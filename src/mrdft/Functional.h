@@ -25,7 +25,9 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
+#include <vector>
 
 #include <Eigen/Core>
 #include <MRCPP/MWFunctions>
@@ -36,6 +38,27 @@ namespace mrdft {
 
 using XC_p = std::unique_ptr<xcfun_t, decltype(&xcfun_delete)>;
 
+/** @brief Work buffers for the node by node XC evaluation
+ *
+ * One instance per thread, reused for all nodes of the grid. Eigen only
+ * reallocates when a buffer changes size, and all end nodes hold the same
+ * number of points, so after the first node no heap allocation takes place.
+ */
+struct NodeBuffers {
+    Eigen::VectorXd values;   ///< Values of a single function in a node
+    Eigen::VectorXd deriv;    ///< Derivative of a single function in a node
+    Eigen::MatrixXd xcDens;   ///< Density values (before local gradients)
+    Eigen::MatrixXd xcInp;    ///< XCFun input values
+    Eigen::MatrixXd xcOut;    ///< XCFun output values
+    Eigen::MatrixXd ctrDens;  ///< Contraction density values (before local gradients)
+    Eigen::MatrixXd ctrInp;   ///< Contraction input values
+    Eigen::MatrixXd ctrOut;   ///< Contracted output values
+    Eigen::MatrixXd nodeOut;  ///< Output values stored on the grid
+    Eigen::MatrixXd calcInp;  ///< Packed XCFun input of points above the cutoff
+    Eigen::MatrixXd calcOut;  ///< Packed XCFun output of points above the cutoff
+    std::vector<int> calcPts; ///< Points above the density cutoff
+};
+
 class Functional {
 public:
     Functional(int k, XC_p &f)
@@ -45,6 +68,8 @@ public:
 
     void setLogGradient(bool log) { log_grad = log; }
     void setDensityCutoff(double cut) { cutoff = cut; }
+    void setNativeLDA(double c_x, double c_c);
+    void setLocalGradient(bool lg) { local_grad = lg; }
 
     virtual bool isSpin() const = 0;
     bool isLDA() const { return (not(isGGA() or isMetaGGA())); }
@@ -62,18 +87,28 @@ public:
 protected:
     const int order;
     bool log_grad{false};
+    bool local_grad{false}; ///< Compute gradients node by node, see xc_utils::local_derivative
+    Eigen::MatrixXd local_D;
     double cutoff{-1.0};
     Eigen::VectorXi d_mask;
     Eigen::MatrixXi xc_mask;
     XC_p xcfun;
 
+    bool native_lda{false}; ///< Bypass XCFun with native Slater + VWN5 kernels
+    double slater_coef{0.0};
+    double vwn5_coef{0.0};
+
     int getXCInputLength() const { return xcfun_input_length(xcfun.get()); }
     int getXCOutputLength() const { return xcfun_output_length(xcfun.get()); }
     virtual int getCtrInputLength() const = 0;
     virtual int getCtrOutputLength() const = 0;
+    int getNodeOutputLength() const;
 
-    Eigen::MatrixXd evaluate(Eigen::MatrixXd &inp) const;
-    Eigen::MatrixXd contract(Eigen::MatrixXd &xc_data, Eigen::MatrixXd &d_data) const;
+    void evaluate(const Eigen::MatrixXd &inp, Eigen::MatrixXd &out, NodeBuffers &buf) const;
+    void evaluate_vec(int nPts, const double *inp, int inp_pitch, double *out, int out_pitch) const;
+    void contract(const Eigen::MatrixXd &xc_data, const Eigen::MatrixXd &d_data, Eigen::MatrixXd &out_data) const;
+    void localInput(const Eigen::MatrixXd &inp_data, const std::array<double, 3> &h, bool use_log, Eigen::MatrixXd &out_data, NodeBuffers &buf) const;
+    void localOutput(const Eigen::MatrixXd &out_data, const std::array<double, 3> &h, Eigen::MatrixXd &pot_data, NodeBuffers &buf) const;
 
     virtual void clear() = 0;
     virtual mrcpp::FunctionTreeVector<3> setupXCInput() = 0;
@@ -60,14 +60,15 @@ int GGA::getCtrInputLength() const {
 /** @brief Collect input functions to xcfun evaluation step
  *
  * For GGA : [rho_0, grad(rho_0)]
+ * With local gradients : [rho_0]
  */
 mrcpp::FunctionTreeVector<3> GGA::setupXCInput() {
     if (this->rho.size() < 1) MSG_ERROR("Density not initialized");
-    if (this->grad.size() < 3) MSG_ERROR("Gradient not initialized");
+    if (this->grad.size() < 3 and not this->local_grad) MSG_ERROR("Gradient not initialized");
 
     mrcpp::FunctionTreeVector<3> out_vec;
     out_vec.push_back(this->rho[0]);
-    out_vec.insert(out_vec.end(), this->grad.begin(), this->grad.begin() + 3);
+    if (not this->local_grad) out_vec.insert(out_vec.end(), this->grad.begin(), this->grad.begin() + 3);
     return out_vec;
 }
 
@@ -77,13 +78,14 @@ mrcpp::FunctionTreeVector<3> GGA::setupXCInput() {
  * Ground State: No contraction, empty vector
  * Linear Response: [rho_1, grad(rho_1)]
  * Higher Response: NOT_IMPLEMENTED
+ * With local gradients the gradient is left out.
  */
 mrcpp::FunctionTreeVector<3> GGA::setupCtrInput() {
     if (this->order > 2) NOT_IMPLEMENTED_ABORT;
     mrcpp::FunctionTreeVector<3> out_vec;
     if (this->order == 2) {
         out_vec.push_back(this->rho[1]);
-        out_vec.insert(out_vec.end(), this->grad.begin() + 3, this->grad.begin() + 6);
+        if (not this->local_grad) out_vec.insert(out_vec.end(), this->grad.begin() + 3, this->grad.begin() + 6);
     }
     return out_vec;
 }
@@ -107,6 +109,9 @@ void GGA::preprocess(mrcpp::FunctionTreeVector<3> &inp_vec) {
     int n = 0;
     for (int i = 0; i < this->order; i++) this->rho.push_back(inp_vec[n++]);
 
+    // gradients are computed node by node in MRDFT::evaluate
+    if (this->local_grad) return;
+
     for (int i = 0; i < this->order; i++) {
         mrcpp::FunctionTreeVector<3> tmp;
         if (this->log_grad and i == 0) {
@@ -125,12 +130,25 @@ void GGA::preprocess(mrcpp::FunctionTreeVector<3> &inp_vec) {
  * For GGA:
  * f_xc       : out[0] = inp[0]
  * df_xc/drho : out[1] = inp[1] - div(inp[2,3,4])
+ *
+ * With local gradients the divergence is already included:
+ * df_xc/drho : out[1] = inp[1]
  */
 mrcpp::FunctionTreeVector<3> GGA::postprocess(mrcpp::FunctionTreeVector<3> &inp_vec) {
     // Energy density
     mrcpp::FunctionTree<3> &f_xc = mrcpp::get_func(inp_vec, 0);
     inp_vec[0] = std::make_tuple<double, mrcpp::FunctionTree<3> *>(1.0, nullptr);
 
+    if (this->local_grad) {
+        mrcpp::FunctionTree<3> &v_xc = mrcpp::get_func(inp_vec, 1);
+        inp_vec[1] = std::make_tuple<double, mrcpp::FunctionTree<3> *>(1.0, nullptr);
+
+        mrcpp::FunctionTreeVector<3> out_vec;
+        out_vec.push_back(std::make_tuple(1.0, &f_xc));
+        out_vec.push_back(std::make_tuple(1.0, &v_xc));
+        return out_vec;
+    }
+
     // Potential part
     mrcpp::FunctionTree<3> &df_dr = mrcpp::get_func(inp_vec, 1);
     mrcpp::FunctionTreeVector<3> df_dg(inp_vec.begin() + 2, inp_vec.begin() + 5);
@@ -25,29 +25,81 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include <MRCPP/MWFunctions>
 
 namespace mrdft {
 
+/** @class Grid
+ *
+ * @brief Persistent evaluation grid for the XC functional
+ *
+ * The grid is kept alive between subsequent evaluations (SCF iterations) and
+ * is extended incrementally with the nodes of each new input density. The
+ * output functions are allocated from a pool of trees that already carry the
+ * grid structure. After use they can be handed back with recycle(), so that
+ * the next evaluation only needs to add the nodes that were introduced since
+ * the last one, instead of allocating and copying the full grid again.
+ */
 class Grid final {
 public:
     Grid(const mrcpp::MultiResolutionAnalysis<3> &mra)
             : tree(mra) {}
-    ~Grid() {}
+    ~Grid() = default;
 
     auto &get() { return tree; }
     auto size() const { return tree.getNEndNodes(); }
 
+    /** @brief Allocate n functions on the current grid
+     *
+     * Trees are taken from the pool if available and extended to the current
+     * grid. Trees that have nodes outside the grid are discarded. Ownership of
+     * the returned trees is passed to the caller.
+     */
     auto generate(int n) {
         mrcpp::FunctionTreeVector<3> out;
         for (int i = 0; i < n; i++) {
-            auto *tmp = new mrcpp::FunctionTree<3>(tree.getMRA());
-            mrcpp::copy_grid(*tmp, tree);
+            mrcpp::FunctionTree<3> *tmp = nullptr;
+            while (tmp == nullptr and this->pool.size() > 0) {
+                tmp = this->pool.back().release();
+                this->pool.pop_back();
+                mrcpp::build_grid(*tmp, tree);
+                if (tmp->getNNodes() != tree.getNNodes()) {
+                    delete tmp;
+                    tmp = nullptr;
+                }
+            }
+            if (tmp == nullptr) {
+                tmp = new mrcpp::FunctionTree<3>(tree.getMRA());
+                mrcpp::copy_grid(*tmp, tree);
+            }
             out.push_back(std::make_tuple(1.0, tmp));
         }
         return out;
     }
 
+    /** @brief Hand back functions for reuse in later evaluations
+     *
+     * Takes ownership of the trees in the vector, which is cleared.
+     * Only trees with the same number of nodes as the grid are kept,
+     * others (e.g. built on an extended grid) are deleted, as are
+     * trees beyond the maximum pool size.
+     */
+    void recycle(mrcpp::FunctionTreeVector<3> &inp) {
+        for (auto i = 0; i < inp.size(); i++) {
+            auto *tree_i = std::get<1>(inp[i]);
+            if (tree_i == nullptr) continue;
+            if (tree_i->getNNodes() == tree.getNNodes() and this->pool.size() < maxPool) {
+                this->pool.push_back(std::unique_ptr<mrcpp::FunctionTree<3>>(tree_i));
+            } else {
+                delete tree_i;
+            }
+        }
+        inp.clear();
+    }
+
     void unify(mrcpp::FunctionTreeVector<3> &inp) {
         // Extend current grid
         for (auto i = 0; i < inp.size(); i++) {
@@ -62,7 +114,9 @@ public:
     }
 
 private:
+    const std::size_t maxPool{16};
     mrcpp::FunctionTree<3> tree;
+    std::vector<std::unique_ptr<mrcpp::FunctionTree<3>>> pool;
 };
 
 } // namespace mrdft
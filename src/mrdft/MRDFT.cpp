@@ -58,6 +58,12 @@ namespace mrdft {
  * out_vec[0] = f_xc (XC energy density)
  * out_vec[1] = v_xc_a (XC alpha potential)
  * out_vec[2] = v_xc_b (XC beta potential)
+ *
+ * With kernel caching enabled, the raw XCFun output is stored per grid node
+ * and reused in subsequent evaluations, so that only nodes that are new to
+ * the grid are passed through XCFun. This is only valid as long as the XCFun
+ * input (the unperturbed density) is unchanged, e.g. for the XC kernel in
+ * linear response, and the owner must call clearKernelCache() if it changes.
  */
 mrcpp::FunctionTreeVector<3> MRDFT::evaluate(mrcpp::FunctionTreeVector<3> &inp) {
     mrcpp::Timer t_tot, t_pre;
@@ -77,40 +83,83 @@ mrcpp::FunctionTreeVector<3> MRDFT::evaluate(mrcpp::FunctionTreeVector<3> &inp)
 
     mrcpp::Timer t_eval;
     int nCoefs = mrcpp::get_func(inp, 0).getEndFuncNode(0).getNCoefs();
-    int nOutCtr = functional().getCtrOutputLength();
+    int nOutCtr = functional().getNodeOutputLength();
     int nFcs = functional().getXCOutputLength();
 
-    // divide nNodes into parts assigned to each MPI rank
+    // derivative matrix for node local gradients
+    bool local_grad = functional().local_grad;
+    if (local_grad) {
+        int kp1 = mrcpp::get_func(inp, 0).getOrder() + 1;
+        if (functional().local_D.rows() != kp1) functional().local_D = xc_utils::local_derivative_matrix(kp1);
+    }
+
+    // screen away nodes where the density is below cutoff everywhere
     int nNodes = grid().size();
-    int n_start = (mrcpp::mpi::wrk_rank * nNodes) / mrcpp::mpi::wrk_size;
-    int n_end = ((mrcpp::mpi::wrk_rank + 1) * nNodes) / mrcpp::mpi::wrk_size;
-    std::vector<Eigen::MatrixXd> ctrOutDataVec(n_end - n_start);
+    std::vector<int> activeNodes = screenNodes(xcInpVec);
+    int nActive = activeNodes.size();
+    mrcpp::print::value(3, "Screened nodes", nNodes - nActive, "", 0, false);
+
+    // divide active nodes into parts of equal measured cost for each MPI rank
+    std::vector<int> partition = partitionNodes(activeNodes);
+    int n_start = partition[mrcpp::mpi::wrk_rank];
+    int n_end = partition[mrcpp::mpi::wrk_rank + 1];
+    int nodeSize = nOutCtr * nCoefs;
+    Eigen::MatrixXd ctrOutBuffer; // one column per active node (plus its timings), only used with MPI
+    if (mrcpp::mpi::wrk_size > 1) ctrOutBuffer = Eigen::MatrixXd::Zero(nodeSize + 2, nActive);
     mrcpp::FunctionTreeVector<3> ctrOutVec;
     if (mrcpp::mpi::wrk_size == 1) ctrOutVec = grid().generate(nOutCtr);
+    std::vector<Eigen::MatrixXd> newKernels((cache_kernel) ? n_end - n_start : 0);
 
 #pragma omp parallel
     {
-#pragma omp for schedule(guided)
-        for (int n = n_start; n < n_end; n++) {
-            auto xcInpNodes = xc_utils::fetch_nodes(n, xcInpVec);
-            auto xcInpData = xc_utils::compress_nodes(xcInpNodes);
+        NodeBuffers buf; // per-thread work buffers, reused for all nodes
+#pragma omp for schedule(dynamic)
+        for (int i = n_start; i < n_end; i++) {
+            int n = activeNodes[i];
+            mrcpp::Timer t_xc;
+            std::array<double, 3> h;
+            if (local_grad) h = xc_utils::calc_cell_size(grid().get().getEndFuncNode(n));
 
-            auto xcOutData = functional().evaluate(xcInpData);
-            auto ctrInpNodes = xc_utils::fetch_nodes(n, ctrInpVec);
-            auto ctrInpData = xc_utils::compress_nodes(ctrInpNodes);
-            auto ctrOutData = functional().contract(xcOutData, ctrInpData);
+            const Eigen::MatrixXd *xcOutData = &buf.xcOut;
+            auto cached = (cache_kernel) ? kernel_cache.find(getNodeKey(n)) : kernel_cache.end();
+            if (cached != kernel_cache.end()) {
+                xcOutData = &cached->second;
+            } else {
+                auto &xcInpData = (local_grad) ? buf.xcDens : buf.xcInp;
+                xc_utils::compress_nodes(n, xcInpVec, buf.values, xcInpData);
+                if (local_grad) functional().localInput(buf.xcDens, h, functional().log_grad, buf.xcInp, buf);
+                functional().evaluate(buf.xcInp, buf.xcOut, buf);
+                if (cache_kernel) newKernels[i - n_start] = buf.xcOut;
+            }
+            double time_xc = (xcOutData == &buf.xcOut) ? t_xc.elapsed() : 0.0;
+
+            mrcpp::Timer t_ctr;
+            auto &ctrInpData = (local_grad) ? buf.ctrDens : buf.ctrInp;
+            xc_utils::compress_nodes(n, ctrInpVec, buf.values, ctrInpData);
+            if (local_grad and ctrInpData.rows() > 0) functional().localInput(buf.ctrDens, h, false, buf.ctrInp, buf);
+            functional().contract(*xcOutData, buf.ctrInp, buf.ctrOut);
+            if (local_grad) functional().localOutput(buf.ctrOut, h, buf.nodeOut, buf);
+            const auto &ctrOutData = (local_grad) ? buf.nodeOut : buf.ctrOut;
 
             if (mrcpp::mpi::wrk_size > 1) {
                 // store the results temporarily
-                ctrOutDataVec[n - n_start] = std::move(ctrOutData);
+                Eigen::Map<Eigen::MatrixXd>(ctrOutBuffer.col(i).data(), nOutCtr, nCoefs) = ctrOutData;
+                ctrOutBuffer(nodeSize, i) = time_xc;
+                ctrOutBuffer(nodeSize + 1, i) = t_ctr.elapsed();
             } else {
                 // postprocess the results
-                auto ctrOutNodes = xc_utils::fetch_nodes(n, ctrOutVec);
-                xc_utils::expand_nodes(ctrOutNodes, ctrOutData);
+                xc_utils::expand_nodes(n, ctrOutVec, buf.values, ctrOutData);
             }
         }
     }
 
+    // Store newly evaluated XCFun output for later evaluations
+    if (cache_kernel) {
+        for (int i = n_start; i < n_end; i++) {
+            if (newKernels[i - n_start].size() > 0) kernel_cache[getNodeKey(activeNodes[i])] = std::move(newKernels[i - n_start]);
+        }
+    }
+
     // Input data is cleared before constructing the full output
     mrcpp::clear(xcInpVec, false);
     mrcpp::clear(ctrInpVec, false);
@@ -119,19 +168,32 @@ mrcpp::FunctionTreeVector<3> MRDFT::evaluate(mrcpp::FunctionTreeVector<3> &inp)
         // each MPI process has only a part of the results
 
         ctrOutVec = grid().generate(nOutCtr);
-        mrcpp::BankAccount ctrOutBank; // to put the ctrOutDataVec;
+        allgatherNodes(ctrOutBuffer, partition);
+        updateNodeCost(activeNodes, partition, ctrOutBuffer, nodeSize);
 
-        // note that mpi cannot run in multiple omp threads
-        int size = nOutCtr * nCoefs;
-        for (int n = n_start; n < n_end; n++) ctrOutBank.put_data(n, size, ctrOutDataVec[n - n_start].data());
-        // fetch all nodes from bank and postprocess
-        for (int n = 0; n < nNodes; n++) {
+        // postprocess all active nodes
+#pragma omp parallel
+        {
+            Eigen::VectorXd values;
             Eigen::MatrixXd ctrOutData(nOutCtr, nCoefs);
-            ctrOutBank.get_data(n, size, ctrOutData.data());
+#pragma omp for schedule(static)
+            for (int i = 0; i < nActive; i++) {
+                ctrOutData = Eigen::Map<Eigen::MatrixXd>(ctrOutBuffer.col(i).data(), nOutCtr, nCoefs);
+                xc_utils::expand_nodes(activeNodes[i], ctrOutVec, values, ctrOutData);
+            }
+        }
+    }
+
+    // screened nodes give zero output
+    if (nActive < nNodes) {
+        std::vector<bool> isActive(nNodes, false);
+        for (auto n : activeNodes) isActive[n] = true;
+        for (int n = 0; n < nNodes; n++) {
+            if (isActive[n]) continue;
             auto ctrOutNodes = xc_utils::fetch_nodes(n, ctrOutVec);
-            xc_utils::expand_nodes(ctrOutNodes, ctrOutData);
+            for (auto *node : ctrOutNodes) node->zeroCoefs();
         }
-  }
+    }
 
     // Reconstruct raw xcfun output functions
     /*
@@ -158,7 +220,7 @@ mrcpp::FunctionTreeVector<3> MRDFT::evaluate(mrcpp::FunctionTreeVector<3> &inp)
 
     mrcpp::Timer t_post;
     auto potOutVec = functional().postprocess(ctrOutVec);
-    mrcpp::clear(ctrOutVec, true);
+    grid().recycle(ctrOutVec);
     functional().clear();
 
     int outNodes = 0;
@@ -176,4 +238,158 @@ mrcpp::FunctionTreeVector<3> MRDFT::evaluate(mrcpp::FunctionTreeVector<3> &inp)
     return potOutVec;
 }
 
+/** @brief Distribute the locally computed node data to all MPI ranks
+ *
+ * Each column of the buffer holds the packed data of one active node, and
+ * each rank has filled the contiguous block of columns corresponding to its
+ * part of the node partition. The full buffer is assembled on all ranks with
+ * a single collective, instead of one bank round-trip per node.
+ *
+ * param[inout] buffer Packed node data, one column per active node
+ * param[in] partition First column of each rank, and total number of columns
+ */
+void MRDFT::allgatherNodes(Eigen::MatrixXd &buffer, const std::vector<int> &partition) {
+#ifdef MRCPP_HAS_MPI
+    int wrk_size = mrcpp::mpi::wrk_size;
+    std::vector<int> counts(wrk_size);
+    std::vector<int> displs(wrk_size);
+    for (int r = 0; r < wrk_size; r++) {
+        displs[r] = partition[r];
+        counts[r] = partition[r + 1] - partition[r];
+    }
+
+    // one MPI element per node, to avoid integer overflow on large grids
+    MPI_Datatype node_type;
+    MPI_Type_contiguous(buffer.rows(), MPI_DOUBLE, &node_type);
+    MPI_Type_commit(&node_type);
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, buffer.data(), counts.data(), displs.data(), node_type, mrcpp::mpi::comm_wrk);
+    MPI_Type_free(&node_type);
+#endif
+}
+
+/** @brief Collect the grid nodes that need functional evaluation
+ *
+ * A node is screened away if an upper bound for the unperturbed density
+ * (both spin densities in the spin separated case) is below the density
+ * cutoff everywhere within the node. All points of such nodes would be
+ * screened in Functional::evaluate anyway, so the XC output is zero and
+ * the node can be skipped altogether. The bound is computed from the
+ * node coefficients without transforming to function values.
+ *
+ * The list is identical on all MPI ranks, since the input densities are.
+ *
+ * param[in] xcInpVec Input functions to xcfun, densities first
+ * param[out] Indices of the active nodes in the grid's EndNodeTable
+ */
+std::vector<int> MRDFT::screenNodes(mrcpp::FunctionTreeVector<3> &xcInpVec) {
+    int nNodes = grid().size();
+    std::vector<int> activeNodes;
+    activeNodes.reserve(nNodes);
+
+    double cutoff = functional().cutoff;
+    int nDens = (functional().isSpin()) ? 2 : 1;
+    for (int n = 0; n < nNodes; n++) {
+        bool screen = (cutoff > 0.0);
+        for (int i = 0; i < nDens and screen; i++) {
+            auto &rho_i = mrcpp::get_func(xcInpVec, i);
+            if (xc_utils::calc_node_bound(rho_i.getEndFuncNode(n)) >= cutoff) screen = false;
+        }
+        if (not screen) activeNodes.push_back(n);
+    }
+    return activeNodes;
+}
+
+/** @brief Divide the active nodes into contiguous parts of equal cost
+ *
+ * The cost of a node is the time measured for it in the previous evaluation
+ * (see updateNodeCost), split into the XCFun evaluation and the contraction.
+ * With kernel caching the XCFun part is free on the rank that holds the
+ * cached output of the node, so that cached nodes preferably stay where they
+ * are. Nodes without a measured time (new nodes, or the first evaluation)
+ * count as the average uncached node, or all nodes count the same if nothing
+ * has been measured. The measured times are identical on all ranks, and so
+ * is the partition.
+ *
+ * param[in] activeNodes Indices of the active nodes in the grid's EndNodeTable
+ * param[out] First node of each rank, followed by the total number of nodes
+ */
+std::vector<int> MRDFT::partitionNodes(const std::vector<int> &activeNodes) {
+    int nActive = activeNodes.size();
+    int wrk_size = mrcpp::mpi::wrk_size;
+
+    std::vector<int> partition(wrk_size + 1, nActive);
+    partition[0] = 0;
+    if (wrk_size == 1) return partition;
+
+    // average cost of an uncached node
+    double c_avg = 1.0;
+    if (node_cost.size() > 0) {
+        double c_sum = 0.0;
+        for (const auto &c : node_cost) c_sum += c.second.xc + c.second.ctr;
+        if (c_sum > 0.0) c_avg = c_sum / node_cost.size();
+    }
+
+    std::vector<NodeCost> cost(nActive);
+    double totCost = 0.0;
+    for (int i = 0; i < nActive; i++) {
+        auto c = node_cost.find(getNodeKey(activeNodes[i]));
+        if (c != node_cost.end()) {
+            cost[i] = c->second;
+        } else {
+            cost[i].xc = c_avg;
+        }
+        if (not cache_kernel) cost[i].owner = -1;
+        totCost += cost[i].ctr + ((cost[i].owner < 0) ? cost[i].xc : 0.0);
+    }
+
+    double accCost = 0.0;
+    int i = 0;
+    for (int r = 1; r < wrk_size; r++) {
+        double target = (r * totCost) / wrk_size;
+        while (i < nActive and accCost < target) {
+            accCost += cost[i].ctr + ((cost[i].owner == r - 1) ? 0.0 : cost[i].xc);
+            i++;
+        }
+        partition[r] = i;
+    }
+    return partition;
+}
+
+/** @brief Record the measured cost of each active node for the next partition
+ *
+ * The timings are collected along with the node data, such that all ranks
+ * see the same times. The XCFun time is zero for a cache hit, in which case
+ * the time of the original evaluation is kept. A node evaluated with kernel
+ * caching is from now on cached on the rank that evaluated it.
+ *
+ * param[in] activeNodes Indices of the active nodes in the grid's EndNodeTable
+ * param[in] partition First node of each rank, followed by the total number of nodes
+ * param[in] buffer Gathered node data, one column per active node
+ * param[in] row Row of the XCFun time in the buffer, followed by the contraction time
+ */
+void MRDFT::updateNodeCost(const std::vector<int> &activeNodes, const std::vector<int> &partition, const Eigen::MatrixXd &buffer, int row) {
+    int r = 0;
+    for (int i = 0; i < activeNodes.size(); i++) {
+        while (i >= partition[r + 1]) r++;
+        auto &c = node_cost[getNodeKey(activeNodes[i])];
+        c.ctr = buffer(row + 1, i);
+        if (buffer(row, i) > 0.0) {
+            c.xc = buffer(row, i);
+            if (cache_kernel) c.owner = r;
+        }
+    }
+}
+
+/** @brief Discard the cached XCFun output, e.g. when the unperturbed density changes */
+void MRDFT::clearKernelCache() {
+    kernel_cache.clear();
+    for (auto &c : node_cost) c.second.owner = -1;
+}
+
+/** @brief Unique key for a grid node, (scale, translation) of its NodeIndex */
+MRDFT::NodeKey MRDFT::getNodeKey(int n) {
+    const auto &idx = grid().get().getEndFuncNode(n).getNodeIndex();
+    return {idx.getScale(), idx.getTranslation(0), idx.getTranslation(1), idx.getTranslation(2)};
+}
+
 } // namespace mrdft
@@ -25,7 +25,10 @@
 
 #pragma once
 
+#include <array>
+#include <map>
 #include <memory>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
@@ -46,9 +49,31 @@ public:
 
     mrcpp::FunctionTreeVector<3> evaluate(mrcpp::FunctionTreeVector<3> &inp);
 
+    void setKernelCaching(bool c) { cache_kernel = c; }
+    void clearKernelCache();
+
 private:
+    using NodeKey = std::array<int, 4>;
+
+    struct NodeCost {
+        double xc{0.0};  ///< Time of the last XCFun evaluation of the node
+        double ctr{0.0}; ///< Time of the last contraction of the node
+        int owner{-1};   ///< MPI rank holding the cached XCFun output (negative: none)
+    };
+
     std::unique_ptr<Grid> G{nullptr};
     std::unique_ptr<Functional> F{nullptr};
+
+    bool cache_kernel{false};                       ///< Keep XCFun output between evaluations
+    std::map<NodeKey, Eigen::MatrixXd> kernel_cache; ///< XCFun output per grid node
+    std::map<NodeKey, NodeCost> node_cost;           ///< Measured cost per grid node, identical on all ranks
+
+    NodeKey getNodeKey(int n);
+
+    std::vector<int> screenNodes(mrcpp::FunctionTreeVector<3> &xcInpVec);
+    std::vector<int> partitionNodes(const std::vector<int> &activeNodes);
+    void allgatherNodes(Eigen::MatrixXd &buffer, const std::vector<int> &partition);
+    void updateNodeCost(const std::vector<int> &activeNodes, const std::vector<int> &partition, const Eigen::MatrixXd &buffer, int row);
 };
 
 } // namespace mrdft
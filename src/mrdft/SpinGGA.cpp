@@ -62,16 +62,19 @@ int SpinGGA::getCtrInputLength() const {
 /** @brief Collect input functions to xcfun evaluation step
  *
  * For SpinGGA : [alpha_0, beta_0, grad(alpha_0), grad(beta_0)]
+ * With local gradients : [alpha_0, beta_0]
  */
 mrcpp::FunctionTreeVector<3> SpinGGA::setupXCInput() {
     if (this->rho_a.size() < 1) MSG_ERROR("Alpha density not initialized");
     if (this->rho_b.size() < 1) MSG_ERROR("Beta density not initialized");
-    if (this->grad_a.size() < 3) MSG_ERROR("Alpha gradient not initialized");
-    if (this->grad_b.size() < 3) MSG_ERROR("Beta gradient not initialized");
 
     mrcpp::FunctionTreeVector<3> out_vec;
     out_vec.push_back(this->rho_a[0]);
     out_vec.push_back(this->rho_b[0]);
+    if (this->local_grad) return out_vec;
+
+    if (this->grad_a.size() < 3) MSG_ERROR("Alpha gradient not initialized");
+    if (this->grad_b.size() < 3) MSG_ERROR("Beta gradient not initialized");
     out_vec.insert(out_vec.end(), this->grad_a.begin(), this->grad_a.begin() + 3);
     out_vec.insert(out_vec.end(), this->grad_b.begin(), this->grad_b.begin() + 3);
     return out_vec;
@@ -83,6 +86,7 @@ mrcpp::FunctionTreeVector<3> SpinGGA::setupXCInput() {
  * Ground State: No contraction, empty vector
  * Linear Response: [alpha_1, beta_1, grad(alpha_1), grad(beta_1)]
  * Higher Response: NOT_IMPLEMENTED
+ * With local gradients the gradients are left out.
  */
 mrcpp::FunctionTreeVector<3> SpinGGA::setupCtrInput() {
     if (this->order > 2) NOT_IMPLEMENTED_ABORT;
@@ -90,6 +94,7 @@ mrcpp::FunctionTreeVector<3> SpinGGA::setupCtrInput() {
     if (this->order == 2) {
         out_vec.push_back(this->rho_a[1]);
         out_vec.push_back(this->rho_b[1]);
+        if (this->local_grad) return out_vec;
         out_vec.insert(out_vec.end(), this->grad_a.begin() + 3, this->grad_a.begin() + 6);
         out_vec.insert(out_vec.end(), this->grad_b.begin() + 3, this->grad_b.begin() + 6);
     }
@@ -120,6 +125,9 @@ void SpinGGA::preprocess(mrcpp::FunctionTreeVector<3> &inp_vec) {
         this->rho_b.push_back(inp_vec[n++]);
     }
 
+    // gradients are computed node by node in MRDFT::evaluate
+    if (this->local_grad) return;
+
     for (int i = 0; i < this->order; i++) {
         mrcpp::FunctionTreeVector<3> tmp_a, tmp_b;
         if (this->log_grad and i == 0) {
@@ -142,12 +150,29 @@ void SpinGGA::preprocess(mrcpp::FunctionTreeVector<3> &inp_vec) {
  * f_xc         : out[0] = inp[0]
  * df_xc/drho_a : out[1] = inp[1] - div(inp[3,4,5])
  * df_xc/drho_b : out[2] = inp[2] - div(inp[6,7,8])
+ *
+ * With local gradients the divergence is already included:
+ * df_xc/drho_a : out[1] = inp[1]
+ * df_xc/drho_b : out[2] = inp[2]
  */
 mrcpp::FunctionTreeVector<3> SpinGGA::postprocess(mrcpp::FunctionTreeVector<3> &inp_vec) {
     // Energy density
     mrcpp::FunctionTree<3> &f_xc = mrcpp::get_func(inp_vec, 0);
     inp_vec[0] = std::make_tuple<double, mrcpp::FunctionTree<3> *>(1.0, nullptr);
 
+    if (this->local_grad) {
+        mrcpp::FunctionTree<3> &v_a = mrcpp::get_func(inp_vec, 1);
+        mrcpp::FunctionTree<3> &v_b = mrcpp::get_func(inp_vec, 2);
+        inp_vec[1] = std::make_tuple<double, mrcpp::FunctionTree<3> *>(1.0, nullptr);
+        inp_vec[2] = std::make_tuple<double, mrcpp::FunctionTree<3> *>(1.0, nullptr);
+
+        mrcpp::FunctionTreeVector<3> out_vec;
+        out_vec.push_back(std::make_tuple(1.0, &f_xc));
+        out_vec.push_back(std::make_tuple(1.0, &v_a));
+        out_vec.push_back(std::make_tuple(1.0, &v_b));
+        return out_vec;
+    }
+
     // Alpha part
     mrcpp::FunctionTree<3> &df_da = mrcpp::get_func(inp_vec, 1);
     mrcpp::FunctionTreeVector<3> df_dga(inp_vec.begin() + 3, inp_vec.begin() + 6);
@@ -0,0 +1,139 @@
+/*
+ * MRChem, a numerical real-space code for molecular electronic structure
+ * calculations within the self-consistent field (SCF) approximations of quantum
+ * chemistry (Hartree-Fock and Density Functional Theory).
+ * Copyright (C) 2023 Stig Rune Jensen, Luca Frediani, Peter Wind and contributors.
+ *
+ * This file is part of MRChem.
+ *
+ * MRChem is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MRChem is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with MRChem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * For information on the complete list of contributors to MRChem, see:
+ * <https://mrchem.readthedocs.io/>
+ */
+
+#include <cmath>
+
+#include <MRCPP/Printer>
+#include <MRCPP/constants.h>
+
+#include "xc_kernels.h"
+
+/** @file xc_kernels.cpp
+ *
+ * @brief Native implementations of common LDA functionals
+ *
+ * These kernels reproduce the XCFun output for spin-restricted LDA in
+ * partial derivative mode, i.e. for each point the values
+ *
+ * out[0] = f(rho)
+ * out[1] = df/drho        (order >= 1)
+ * out[2] = d^2f/drho^2    (order >= 2)
+ *
+ * The result is ADDED to the output array, so that several kernels can be
+ * accumulated into the same buffer, which must be zeroed by the caller.
+ * The point loops are written without branches on the data (apart from
+ * the tiny density screening) so that they are vectorized by the compiler.
+ * Densities below the XCFun tiny density threshold give zero output, as in
+ * XCFun.
+ */
+
+namespace mrdft {
+
+namespace xc_kernels {
+const double tiny_density = 1.0e-14;
+} // namespace xc_kernels
+
+/** @brief Slater exchange
+ *
+ * f(rho) = -C_x * rho^(4/3),  C_x = 3/4 * (3/pi)^(1/3)
+ *
+ * param[in] order Highest derivative order (0, 1 or 2)
+ * param[in] nPts Number of grid points
+ * param[in] rho Density values, contiguous
+ * param[out] out Output values, pitch out_pitch per point
+ * param[in] coef Prefactor of the functional
+ */
+void xc_kernels::slater_x(int order, int nPts, const double *rho, double *out, int out_pitch, double coef) {
+    if (order < 0 or order > 2) NOT_IMPLEMENTED_ABORT;
+    const double C_x = 0.75 * std::cbrt(3.0 / mrcpp::pi);
+
+#pragma omp simd
+    for (int i = 0; i < nPts; i++) {
+        const double n = (rho[i] > tiny_density) ? rho[i] : 1.0;
+        const double w = (rho[i] > tiny_density) ? coef : 0.0;
+        const double n_13 = std::cbrt(n);
+        double *out_i = out + i * out_pitch;
+        out_i[0] -= w * C_x * n * n_13;
+        if (order > 0) out_i[1] -= w * (4.0 / 3.0) * C_x * n_13;
+        if (order > 1) out_i[2] -= w * (4.0 / 9.0) * C_x / (n_13 * n_13);
+    }
+}
+
+/** @brief VWN5 correlation (paramagnetic fit)
+ *
+ * f(rho) = rho * eps(x),  x = sqrt(r_s),  r_s = (3/(4*pi*rho))^(1/3)
+ *
+ * eps(x) = A * [ln(x^2/X(x)) + 2b/Q * atan(Q/(2x+b))
+ *        - b*x0/X(x0) * (ln((x-x0)^2/X(x)) + 2(b+2x0)/Q * atan(Q/(2x+b)))]
+ *
+ * with X(x) = x^2 + b*x + c and Q = sqrt(4c - b^2). The rho derivatives
+ * follow from the analytical x derivatives of eps through dx/drho = -x/(6 rho):
+ *
+ * df/drho     = eps - x*eps'/6
+ * d^2f/drho^2 = -x*(5*eps' - x*eps'')/(36 rho)
+ *
+ * param[in] order Highest derivative order (0, 1 or 2)
+ * param[in] nPts Number of grid points
+ * param[in] rho Density values, contiguous
+ * param[out] out Output values, pitch out_pitch per point
+ * param[in] coef Prefactor of the functional
+ */
+void xc_kernels::vwn5_c(int order, int nPts, const double *rho, double *out, int out_pitch, double coef) {
+    if (order < 0 or order > 2) NOT_IMPLEMENTED_ABORT;
+    const double A = 0.0310907;
+    const double b = 3.72744;
+    const double c = 12.9352;
+    const double x0 = -0.10498;
+    const double Q = std::sqrt(4.0 * c - b * b);
+    const double X0 = x0 * x0 + b * x0 + c;
+    const double bx0_X0 = b * x0 / X0;
+    const double rs_fac = 3.0 / (4.0 * mrcpp::pi);
+
+#pragma omp simd
+    for (int i = 0; i < nPts; i++) {
+        const double n = (rho[i] > tiny_density) ? rho[i] : 1.0;
+        const double w = (rho[i] > tiny_density) ? coef : 0.0;
+        const double x = std::sqrt(std::cbrt(rs_fac / n));
+        const double X = x * x + b * x + c;
+        const double at = std::atan(Q / (2.0 * x + b));
+        const double dx0 = x - x0;
+
+        const double eps = A * (std::log(x * x / X) + 2.0 * b / Q * at - bx0_X0 * (std::log(dx0 * dx0 / X) + 2.0 * (b + 2.0 * x0) / Q * at));
+        const double eps_x = A * (2.0 / x - 2.0 * (x + b) / X - bx0_X0 * (2.0 / dx0 - 2.0 * (x + b + x0) / X));
+
+        double *out_i = out + i * out_pitch;
+        out_i[0] += w * n * eps;
+        if (order > 0) out_i[1] += w * (eps - x * eps_x / 6.0);
+        if (order > 1) {
+            const double X2 = X * X;
+            const double t1 = (2.0 * X - 2.0 * (x + b) * (2.0 * x + b)) / X2;
+            const double t2 = (2.0 * X - 2.0 * (x + b + x0) * (2.0 * x + b)) / X2;
+            const double eps_xx = A * (-2.0 / (x * x) - t1 - bx0_X0 * (-2.0 / (dx0 * dx0) - t2));
+            out_i[2] += w * (-x * (5.0 * eps_x - x * eps_xx) / (36.0 * n));
+        }
+    }
+}
+
+} // namespace mrdft
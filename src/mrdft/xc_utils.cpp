@@ -24,6 +24,7 @@
  */
 
 #include <MRCPP/MWOperators>
+#include <MRCPP/core/GaussQuadrature.h>
 #include <MRCPP/Printer>
 #include <MRCPP/trees/FunctionNode.h>
 
@@ -136,46 +137,172 @@ std::vector<mrcpp::FunctionNode<3> *> xc_utils::fetch_nodes(int n, mrcpp::Functi
 
 /** @brief Collect data from FunctionNodes into a matrix
  *
- * Collects function values from the input nodes into the rows
- * of a matrix. Matrix dimension: rows = nNodes, cols = nCoefs.
+ * Collects function values from node n of each input tree into the
+ * rows of a matrix. Matrix dimension: rows = nTrees, cols = nCoefs.
+ * The matrix and the work vector are resized only if needed, so that
+ * buffers can be reused across nodes without heap allocation.
  *
- * param[in] inp_nodes Array of FunctionNodes
+ * param[in] n Node position in EndNodeTable
+ * param[in] inp_trees Array of FunctionTrees
+ * param[inout] tmp Work vector for the values of a single node
  * param[out] out_data Matrix of function values
  */
-Eigen::MatrixXd xc_utils::compress_nodes(std::vector<mrcpp::FunctionNode<3> *> &inp_nodes) {
-    Eigen::MatrixXd out_data;
-    auto nNodes = inp_nodes.size();
-    if (nNodes > 0) {
-        auto nCoefs = inp_nodes[0]->getNCoefs();
-        out_data = Eigen::MatrixXd::Zero(nNodes, nCoefs);
-        for (auto i = 0; i < nNodes; i++) {
-            auto &node = inp_nodes[i];
-            Eigen::VectorXd row_i;
-            node->getValues(row_i);
-            if (row_i.size() != nCoefs) MSG_ABORT("Size mismatch");
-            out_data.row(i) = row_i;
-        }
+void xc_utils::compress_nodes(int n, mrcpp::FunctionTreeVector<3> &inp_trees, Eigen::VectorXd &tmp, Eigen::MatrixXd &out_data) {
+    auto nTrees = inp_trees.size();
+    if (nTrees == 0) {
+        out_data.resize(0, 0);
+        return;
+    }
+    auto nCoefs = mrcpp::get_func(inp_trees, 0).getEndFuncNode(n).getNCoefs();
+    out_data.resize(nTrees, nCoefs);
+    for (auto i = 0; i < nTrees; i++) {
+        auto &node = mrcpp::get_func(inp_trees, i).getEndFuncNode(n);
+        node.getValues(tmp);
+        if (tmp.size() != nCoefs) MSG_ABORT("Size mismatch");
+        out_data.row(i) = tmp.transpose();
     }
-    return out_data;
 }
 
 /** @brief Put data from a matrix into FunctionNodes
  *
  * Each row of the input data is used as function values
- * of the corresponding FunctionNode in the output vector.
- * Matrix dimension: rows = nNodes, cols = nCoefs.
+ * of node n in the corresponding output tree.
+ * Matrix dimension: rows = nTrees, cols = nCoefs.
  *
- * param[inout] out_nodes Array of FunctionNodes
+ * param[in] n Node position in EndNodeTable
+ * param[inout] out_trees Array of FunctionTrees
+ * param[inout] tmp Work vector for the values of a single node
  * param[in] inp_data Matrix of function values
  */
-void xc_utils::expand_nodes(std::vector<mrcpp::FunctionNode<3> *> &out_nodes, Eigen::MatrixXd &inp_data) {
-    auto nFuncs = out_nodes.size();
-    if (inp_data.rows() != nFuncs) MSG_ERROR("Size mismatch " << inp_data.rows() << " vs " << nFuncs);
+void xc_utils::expand_nodes(int n, mrcpp::FunctionTreeVector<3> &out_trees, Eigen::VectorXd &tmp, const Eigen::MatrixXd &inp_data) {
+    auto nTrees = out_trees.size();
+    if (inp_data.rows() != nTrees) MSG_ERROR("Size mismatch " << inp_data.rows() << " vs " << nTrees);
+
+    for (auto i = 0; i < nTrees; i++) {
+        auto &node = mrcpp::get_func(out_trees, i).getEndFuncNode(n);
+        tmp = inp_data.row(i).transpose();
+        node.setValues(tmp);
+    }
+}
+
+/** @brief Upper bound for the absolute function value within a node
+ *
+ * For an orthonormal polynomial basis the sum of the squared basis functions
+ * is bounded by (k+1)^2 per dimension and unit length, independent of the
+ * choice of basis (Legendre or Interpolating). By Cauchy-Schwarz this gives
+ *
+ * |f(r)| <= ||c|| * (k+1)^3 / sqrt(V/8)
+ *
+ * where ||c|| is the norm of the node coefficients (scaling and wavelet)
+ * and V/8 is the volume of the node's children. This is a cheap and safe
+ * bound which does not require the transformation to function values.
+ *
+ * param[in] node FunctionNode with coefficients
+ */
+double xc_utils::calc_node_bound(const mrcpp::FunctionNode<3> &node) {
+    auto nCoefs = node.getNCoefs();
+    Eigen::Map<const Eigen::VectorXd> coefs(node.getCoefs(), nCoefs);
+
+    auto &sfac = node.getMWTree().getMRA().getWorldBox().getScalingFactors();
+    auto scale = node.getNodeIndex().getScale();
+    auto vol = sfac[0] * sfac[1] * sfac[2] * std::pow(2.0, -3 * (scale + 1));
+    auto kp1_3 = nCoefs / 8.0; // (k+1)^3 scaling functions per child
+    return coefs.norm() * kp1_3 / std::sqrt(vol);
+}
+
+/** @brief Side lengths of the cells in which node values are given
+ *
+ * The function values of a node are given on the quadrature grids of
+ * its children, i.e. on cells one scale finer than the node itself.
+ *
+ * param[in] node FunctionNode
+ */
+std::array<double, 3> xc_utils::calc_cell_size(const mrcpp::FunctionNode<3> &node) {
+    auto &sfac = node.getMWTree().getMRA().getWorldBox().getScalingFactors();
+    auto scale = node.getNodeIndex().getScale();
+    auto len = std::pow(2.0, -(scale + 1));
+    return {sfac[0] * len, sfac[1] * len, sfac[2] * len};
+}
+
+/** @brief Derivative matrix for polynomials on the unit interval quadrature grid
+ *
+ * D(i,j) = l_j'(x_i), where l_j are the Lagrange polynomials on the
+ * Gauss-Legendre points x_i on [0,1]. Applied to function values on the
+ * quadrature grid it gives the exact derivative of the interpolating
+ * polynomial at the same points.
+ *
+ * param[in] kp1 Number of quadrature points (polynomial order + 1)
+ */
+Eigen::MatrixXd xc_utils::local_derivative_matrix(int kp1) {
+    mrcpp::GaussQuadrature quad(kp1, 0.0, 1.0);
+    const Eigen::VectorXd &x = quad.getRoots();
 
-    for (auto i = 0; i < nFuncs; i++) {
-        auto &node = out_nodes[i];
-        node->setValues(inp_data.row(i));
+    // Barycentric weights
+    Eigen::VectorXd w = Eigen::VectorXd::Ones(kp1);
+    for (int j = 0; j < kp1; j++) {
+        for (int k = 0; k < kp1; k++) {
+            if (k != j) w(j) /= (x(j) - x(k));
+        }
+    }
+
+    Eigen::MatrixXd D = Eigen::MatrixXd::Zero(kp1, kp1);
+    for (int i = 0; i < kp1; i++) {
+        for (int j = 0; j < kp1; j++) {
+            if (i == j) continue;
+            D(i, j) = (w(j) / w(i)) / (x(i) - x(j));
+            D(i, i) -= D(i, j);
+        }
+    }
+    return D;
+}
+
+/** @brief Partial derivative of the node function from its values
+ *
+ * The values are given on the quadrature grids of the 2^3 child cells
+ * of the node, as returned by FunctionNode::getValues. Within each cell
+ * the function is a polynomial, and the derivative is computed by applying
+ * the derivative matrix along the given dimension. Only data within the
+ * node is used, i.e. the (small) discontinuities between neighbouring cells
+ * that are accounted for by the MW derivative operators are neglected.
+ *
+ * param[in] D Derivative matrix from local_derivative_matrix
+ * param[in] h Side lengths of the child cells
+ * param[in] values Function values in the node
+ * param[out] out Derivative values, resized only if needed
+ * param[in] dir Cartesian direction of the derivative
+ */
+void xc_utils::local_derivative(const Eigen::MatrixXd &D, const std::array<double, 3> &h, const Eigen::VectorXd &values, Eigen::VectorXd &out, int dir) {
+    auto kp1 = D.rows();
+    auto kp1_2 = kp1 * kp1;
+    auto kp1_3 = kp1_2 * kp1;
+    auto nCells = values.size() / kp1_3;
+
+    out.resize(values.size());
+    for (auto c = 0; c < nCells; c++) {
+        const double *f_c = values.data() + c * kp1_3;
+        double *df_c = out.data() + c * kp1_3;
+        if (dir == 0) {
+            // first (fastest) index
+            Eigen::Map<const Eigen::MatrixXd> f(f_c, kp1, kp1_2);
+            Eigen::Map<Eigen::MatrixXd> df(df_c, kp1, kp1_2);
+            df.noalias() = D * f;
+        } else if (dir == 1) {
+            // second index, one slab at the time
+            for (auto s = 0; s < kp1; s++) {
+                Eigen::Map<const Eigen::MatrixXd> f(f_c + s * kp1_2, kp1, kp1);
+                Eigen::Map<Eigen::MatrixXd> df(df_c + s * kp1_2, kp1, kp1);
+                df.noalias() = f * D.transpose();
+            }
+        } else if (dir == 2) {
+            // last (slowest) index
+            Eigen::Map<const Eigen::MatrixXd> f(f_c, kp1_2, kp1);
+            Eigen::Map<Eigen::MatrixXd> df(df_c, kp1_2, kp1);
+            df.noalias() = f * D.transpose();
+        } else {
+            MSG_ABORT("Invalid direction");
+        }
     }
+    out /= h[dir];
 }
 
 /** @brief Compute the gradient using a log parametrization
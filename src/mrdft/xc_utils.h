@@ -23,6 +23,8 @@
  * <https://mrchem.readthedocs.io/>
  */
 
+#include <array>
+
 #include <Eigen/Core>
 #include <MRCPP/MWFunctions>
 #include <XCFun/xcfun.h>
@@ -34,8 +36,13 @@ Eigen::MatrixXi build_output_mask(bool is_lda, bool is_spin_sep, int order);
 Eigen::VectorXi build_density_mask(bool is_lda, bool is_spin_sep, int order);
 
 std::vector<mrcpp::FunctionNode<3> *> fetch_nodes(int n, mrcpp::FunctionTreeVector<3> &inp);
-Eigen::MatrixXd compress_nodes(std::vector<mrcpp::FunctionNode<3> *> &inp_nodes);
-void expand_nodes(std::vector<mrcpp::FunctionNode<3> *> &out_nodes, Eigen::MatrixXd &out_data);
+void compress_nodes(int n, mrcpp::FunctionTreeVector<3> &inp_trees, Eigen::VectorXd &tmp, Eigen::MatrixXd &out_data);
+void expand_nodes(int n, mrcpp::FunctionTreeVector<3> &out_trees, Eigen::VectorXd &tmp, const Eigen::MatrixXd &inp_data);
+double calc_node_bound(const mrcpp::FunctionNode<3> &node);
+
+std::array<double, 3> calc_cell_size(const mrcpp::FunctionNode<3> &node);
+Eigen::MatrixXd local_derivative_matrix(int kp1);
+void local_derivative(const Eigen::MatrixXd &D, const std::array<double, 3> &h, const Eigen::VectorXd &values, Eigen::VectorXd &out, int dir);
 
 mrcpp::FunctionTreeVector<3> log_gradient(mrcpp::DerivativeOperator<3> &diff_oper, mrcpp::FunctionTree<3> &rho);
 
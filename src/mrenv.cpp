@@ -30,6 +30,7 @@
 
 #include "mrchem.h"
 #include "mrenv.h"
+#include "scf_solver/HelmholtzVector.h"
 #include "utils/print_utils.h"
 #include "version.h"
 
@@ -130,6 +131,7 @@ void mrenv::init_mpi(const json &json_mpi) {
     mrcpp::mpi::numerically_exact = json_mpi["numerically_exact"];
     mrcpp::mpi::shared_memory_size = json_mpi["shared_memory_size"];
     mrcpp::mpi::bank_size = json_mpi["bank_size"];
+    HelmholtzVector::setMemoryBudget(json_mpi["helmholtz_memory_size"]);
     mrcpp::mpi::initialize(); // NB: must be after bank_size and init_mra but before init_printer and print_header
 }
 
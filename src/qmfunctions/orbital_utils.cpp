@@ -25,6 +25,7 @@
 
 #include <fstream>
 
+#include <MRCPP/MWFunctions>
 #include <MRCPP/Printer>
 #include <MRCPP/Timer>
 #include <MRCPP/trees/FunctionNode.h>
@@ -322,6 +323,41 @@ OrbitalVector orbital::param_copy(const OrbitalVector &Phi) {
     return out;
 }
 
+/** @brief Transfer orbitals to a different MRA
+ *
+ * New orbitals are allocated on the given MRA and adaptively projected
+ * from the piecewise polynomial expansions of the input orbitals, i.e.
+ * the input trees are evaluated directly at the quadrature points of the
+ * new basis. This allows to change the polynomial order of the orbitals
+ * without going back to an analytic representation. When the order is
+ * increased the input polynomials are represented exactly in the new
+ * basis, so the projection error is only limited by the adaptivity.
+ *
+ * MPI: Rank distribution of output vector is the same as input vector
+ *
+ */
+OrbitalVector orbital::change_mra(OrbitalVector &Phi, mrcpp::MultiResolutionAnalysis<3> &mra, double prec) {
+    OrbitalVector out;
+    for (auto &phi_i : Phi) {
+        Orbital out_i(phi_i.spin(), phi_i.occ(), phi_i.getRank());
+        if (mrcpp::mpi::my_orb(out_i)) {
+            if (phi_i.hasReal()) {
+                out_i.alloc(NUMBER::Real, &mra);
+                mrcpp::RepresentableFunction<3> &re_i = phi_i.real();
+                mrcpp::project<3>(prec, out_i.real(), re_i);
+            }
+            if (phi_i.hasImag()) {
+                out_i.alloc(NUMBER::Imag, &mra);
+                mrcpp::RepresentableFunction<3> &im_i = phi_i.imag();
+                mrcpp::project<3>(prec, out_i.imag(), im_i);
+                if (phi_i.conjugate()) out_i.imag().rescale(-1.0);
+            }
+        }
+        out.push_back(out_i);
+    }
+    return out;
+}
+
 /** @brief Adjoin two vectors
  *
  * The orbitals of the input vector are appended to
@@ -1308,6 +1344,51 @@ void orbital::set_occupations(OrbitalVector &Phi, const IntVector &occ) {
     for (int i = 0; i < Phi.size(); i++) Phi[i].setOcc(occ(i));
 }
 
+/** @brief Returns the common phase of a set of orbitals
+ *
+ * Returns NUMBER::Real if all orbitals are purely real, NUMBER::Imag if all
+ * orbitals are purely imaginary, and NUMBER::Total otherwise (complex or
+ * mixed orbitals, or no orbitals with content). Purely imaginary orbitals
+ * arise e.g. as the first-order response of a real ground state to a
+ * magnetic perturbation.
+ *
+ * MPI: all ranks get the same result
+ */
+int orbital::get_pure_phase(const OrbitalVector &Phi) {
+    IntVector parts = IntVector::Zero(3); // complex, real, imag
+    for (const auto &phi_i : Phi) {
+        if (not mrcpp::mpi::my_orb(phi_i)) continue;
+        if (phi_i.hasReal() and phi_i.hasImag()) {
+            parts(0)++;
+        } else if (phi_i.hasReal()) {
+            parts(1)++;
+        } else if (phi_i.hasImag()) {
+            parts(2)++;
+        }
+    }
+    mrcpp::mpi::allreduce_vector(parts, mrcpp::mpi::comm_wrk);
+    if (parts(0) > 0) return NUMBER::Total;
+    if (parts(1) > 0 and parts(2) == 0) return NUMBER::Real;
+    if (parts(2) > 0 and parts(1) == 0) return NUMBER::Imag;
+    return NUMBER::Total;
+}
+
+/** @brief Removes the part of each orbital that is absent in the given phase
+ *
+ * @param Phi: orbitals to restrict
+ * @param phase: NUMBER::Real or NUMBER::Imag, anything else is a no-op
+ *
+ * Used to keep orbitals that are purely real or imaginary by symmetry free
+ * of numerical noise in the other part, which would otherwise be carried
+ * through (and double the cost of) all subsequent operations.
+ */
+void orbital::set_pure_phase(OrbitalVector &Phi, int phase) {
+    for (auto &phi_i : Phi) {
+        if (phase == NUMBER::Real and phi_i.hasImag()) phi_i.free(NUMBER::Imag);
+        if (phase == NUMBER::Imag and phi_i.hasReal()) phi_i.free(NUMBER::Real);
+    }
+}
+
 /** @brief Returns a vector containing the orbital square norms */
 DoubleVector orbital::get_squared_norms(const OrbitalVector &Phi) {
     int nOrbs = Phi.size();
@@ -49,6 +49,7 @@ OrbitalVector rotate(OrbitalVector &Phi, const ComplexMatrix &U, double prec = -
 
 OrbitalVector deep_copy(OrbitalVector &Phi);
 OrbitalVector param_copy(const OrbitalVector &Phi);
+OrbitalVector change_mra(OrbitalVector &Phi, mrcpp::MultiResolutionAnalysis<3> &mra, double prec);
 
 OrbitalVector adjoin(OrbitalVector &Phi_a, OrbitalVector &Phi_b);
 OrbitalVector disjoin(OrbitalVector &Phi, int spin);
@@ -87,6 +88,9 @@ bool orbital_vector_is_sane(const OrbitalVector &Phi);
 
 void set_spins(OrbitalVector &Phi, const IntVector &spins);
 void set_occupations(OrbitalVector &Phi, const IntVector &occ);
+void set_pure_phase(OrbitalVector &Phi, int phase);
+
+int get_pure_phase(const OrbitalVector &Phi);
 
 IntVector get_spins(const OrbitalVector &Phi);
 IntVector get_occupations(const OrbitalVector &Phi);
@@ -28,6 +28,8 @@
 
 #include "qmoperator_utils.h"
 
+#include "analyticfunctions/NuclearGradientFunction.h"
+#include "chemistry/PhysicalConstants.h"
 #include "qmfunctions/Orbital.h"
 #include "qmfunctions/orbital_utils.h"
 #include "qmoperators/QMPotential.h"
@@ -118,6 +120,91 @@ ComplexMatrix qmoperator::calc_kinetic_matrix_symmetrized(MomentumOperator &p, R
     return T_x + T_y + T_z;
 }
 
+/** @brief Trace of the paramagnetic spin-orbit operator for several nuclei
+ *
+ * @param p: momentum operator (must be setup)
+ * @param r_K: nuclear coordinates
+ * @param prec: precision of the products and of the projected r^-3 functions
+ * @param smooth: smoothing parameter of the r^-3 functions
+ * @param Phi: unperturbed orbitals
+ * @param X: perturbed orbitals
+ * @param Y: perturbed orbitals
+ *
+ * Returns one row per nucleus, each row being H_M_pso(r_K).trace(Phi, X, Y).
+ * Since the nuclear factors are purely multiplicative, each component of the
+ * trace can be written as (a,b,c cyclic)
+ *
+ *      tr[h_a rho_1] = alpha^2 (<g_b|T_c> - <g_c|T_b>)
+ *
+ * where g_b = (r - r_K)_b/|r - r_K|^3 and
+ *
+ *      T_c = \sum_i n_i (phi_i^* p_c x_i + y_i^* p_c phi_i)
+ *
+ * The momentum operator is thus applied only once to Phi and X, and the three
+ * T_c functions are shared by all nuclei, which each add only three projected
+ * functions and six inner products instead of a full operator application.
+ *
+ * MPI: T_c is computed from own orbitals, the final matrix is reduced
+ */
+ComplexMatrix qmoperator::calc_pso_trace(MomentumOperator &p, const std::vector<mrcpp::Coord<3>> &r_K, double prec, double smooth, OrbitalVector &Phi, OrbitalVector &X, OrbitalVector &Y) {
+    Timer timer;
+    if (Phi.size() != X.size()) MSG_ERROR("Size mismatch");
+    if (Phi.size() != Y.size()) MSG_ERROR("Size mismatch");
+    const double alpha_2 = PhysicalConstants::get("fine_structure_constant") * PhysicalConstants::get("fine_structure_constant") * 1000000.0;
+    ComplexVector eta = orbital::get_occupations(Phi).cast<ComplexDouble>();
+
+    int nNodes = 0, sNodes = 0;
+    std::vector<mrcpp::ComplexFunction> T(3);
+    for (int c = 0; c < 3; c++) {
+        OrbitalVector pPhi = p[c](Phi);
+        OrbitalVector pX = p[c](X);
+        nNodes = std::max(nNodes, orbital::get_n_nodes(pPhi) + orbital::get_n_nodes(pX));
+        sNodes = std::max(sNodes, orbital::get_size_nodes(pPhi) + orbital::get_size_nodes(pX));
+
+        std::vector<ComplexDouble> coefs;
+        std::vector<mrcpp::ComplexFunction> funcs;
+        for (int i = 0; i < Phi.size(); i++) {
+            if (not mrcpp::mpi::my_orb(Phi[i])) continue;
+            if (std::abs(eta(i)) < mrcpp::MachineZero) continue;
+            mrcpp::ComplexFunction rho_x;
+            mrcpp::ComplexFunction rho_y;
+            mrcpp::cplxfunc::multiply(rho_x, pX[i], Phi[i].dagger(), prec);
+            mrcpp::cplxfunc::multiply(rho_y, pPhi[i], Y[i].dagger(), prec);
+            coefs.push_back(eta(i));
+            funcs.push_back(rho_x);
+            coefs.push_back(eta(i));
+            funcs.push_back(rho_y);
+        }
+        if (funcs.size() == 0) continue;
+
+        // std::vector -> ComplexVector
+        ComplexVector coefsVec(coefs.size());
+        for (int i = 0; i < coefs.size(); i++) coefsVec(i) = coefs[i];
+        mrcpp::cplxfunc::linear_combination(T[c], coefsVec, funcs, prec);
+    }
+
+    ComplexMatrix out = ComplexMatrix::Zero(r_K.size(), 3);
+    for (int k = 0; k < r_K.size(); k++) {
+        // M_bc = <g_b|T_c>, diagonal is not needed
+        ComplexMatrix M = ComplexMatrix::Zero(3, 3);
+        for (int b = 0; b < 3; b++) {
+            NuclearGradientFunction f_b(b, 1.0, r_K[k], smooth);
+            mrcpp::ComplexFunction g_b;
+            mrcpp::cplxfunc::project(g_b, f_b, NUMBER::Real, prec);
+            for (int c = 0; c < 3; c++) {
+                if (b == c) continue;
+                if (T[c].hasReal() or T[c].hasImag()) M(b, c) = mrcpp::cplxfunc::dot(g_b, T[c]);
+            }
+        }
+        out(k, 0) = alpha_2 * (M(1, 2) - M(2, 1));
+        out(k, 1) = alpha_2 * (M(2, 0) - M(0, 2));
+        out(k, 2) = alpha_2 * (M(0, 1) - M(1, 0));
+    }
+    mrcpp::mpi::allreduce_matrix(out, mrcpp::mpi::comm_wrk);
+    mrcpp::print::tree(2, "Trace h_M_pso(rho_1)", nNodes, sNodes, timer.elapsed());
+    return out;
+}
+
 ComplexMatrix qmoperator::calc_kinetic_matrix_component(int d, MomentumOperator &p, OrbitalVector &bra, OrbitalVector &ket) {
     Timer timer;
     int Ni = bra.size();
@@ -38,6 +38,7 @@ ComplexDouble calc_kinetic_trace(MomentumOperator &p, RankZeroOperator &V, Orbit
 ComplexMatrix calc_kinetic_matrix(MomentumOperator &p, OrbitalVector &bra, OrbitalVector &ket);
 ComplexMatrix calc_kinetic_matrix(MomentumOperator &p, RankZeroOperator &V, OrbitalVector &bra, OrbitalVector &ket);
 ComplexMatrix calc_kinetic_matrix_symmetrized(MomentumOperator &p, RankZeroOperator &V, OrbitalVector &bra, OrbitalVector &ket);
+ComplexMatrix calc_pso_trace(MomentumOperator &p, const std::vector<mrcpp::Coord<3>> &r_K, double prec, double smooth, OrbitalVector &Phi, OrbitalVector &X, OrbitalVector &Y);
 } // namespace qmoperator
 
 } // namespace mrchem
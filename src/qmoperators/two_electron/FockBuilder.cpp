@@ -216,18 +216,53 @@ ComplexMatrix FockBuilder::operator()(OrbitalVector &bra, OrbitalVector &ket) {
     return T_mat + V_mat;
 }
 
-OrbitalVector FockBuilder::buildHelmholtzArgument(double prec, OrbitalVector Phi, ComplexMatrix F_mat, ComplexMatrix L_mat) {
+/** @brief Compute the argument of the Helmholtz operators
+ *
+ * @param prec: precision of the rotation
+ * @param Phi: orbitals
+ * @param F_mat: Fock matrix
+ * @param L_mat: diagonal matrix of Helmholtz parameters
+ * @param idx: compute argument only for these orbitals (all if empty)
+ *
+ * The full orbital vector is needed in the rotation, but the potential is
+ * only applied to the requested orbitals. The output vector contains only
+ * the requested orbitals, in the given order.
+ */
+OrbitalVector FockBuilder::buildHelmholtzArgument(double prec, OrbitalVector Phi, ComplexMatrix F_mat, ComplexMatrix L_mat, const std::vector<int> &idx) {
     Timer t_tot;
     auto plevel = Printer::getPrintLevel();
     mrcpp::print::header(2, "Computing Helmholtz argument");
 
+    // Output orbital j is the column U(:,j), only the columns of the requested
+    // orbitals are kept, with their coupling to all other orbitals
+    ComplexMatrix U_mat = L_mat - F_mat;
+    if (not idx.empty()) {
+        ComplexMatrix U_idx = ComplexMatrix::Zero(U_mat.rows(), U_mat.cols());
+        for (auto i : idx) U_idx.col(i) = U_mat.col(i);
+        U_mat = U_idx;
+    }
+
     Timer t_rot;
-    OrbitalVector Psi = orbital::rotate(Phi, L_mat - F_mat, prec);
+    OrbitalVector Psi = orbital::rotate(Phi, U_mat, prec);
     mrcpp::print::time(2, "Rotating orbitals", t_rot);
 
+    DoubleVector eps = F_mat.real().diagonal();
+    if (not idx.empty()) {
+        OrbitalVector Phi_idx, Psi_idx;
+        DoubleVector eps_idx(idx.size());
+        for (int k = 0; k < idx.size(); k++) {
+            Phi_idx.push_back(Phi[idx[k]]);
+            Psi_idx.push_back(Psi[idx[k]]);
+            eps_idx(k) = eps(idx[k]);
+        }
+        Phi = Phi_idx;
+        Psi = Psi_idx;
+        eps = eps_idx;
+    }
+
     OrbitalVector out;
     if (isZora()) {
-        out = buildHelmholtzArgumentZORA(Phi, Psi, F_mat.real().diagonal(), prec);
+        out = buildHelmholtzArgumentZORA(Phi, Psi, eps, prec);
     } else {
         out = buildHelmholtzArgumentNREL(Phi, Psi);
     }
@@ -59,6 +59,16 @@ public:
         XC = potential;
         XC.name() = "V_xc";
     }
+    XCOperator(const XCOperator &ref, std::shared_ptr<OrbitalVector> X, std::shared_ptr<OrbitalVector> Y) {
+        auto ref_potential = std::dynamic_pointer_cast<XCPotentialD2>(ref.potential);
+        if (ref_potential == nullptr) MSG_ABORT("Reference XC operator must be of second order");
+        potential = std::make_shared<XCPotentialD2>(*ref_potential, X, Y);
+
+        // Invoke operator= to assign *this operator
+        RankZeroOperator &XC = (*this);
+        XC = potential;
+        XC.name() = "V_xc";
+    }
     ~XCOperator() override = default;
 
     auto getEnergy() { return potential->getEnergy(); }
@@ -86,7 +86,7 @@ void XCPotential::setup(double prec) {
         this->potentials.push_back(std::make_tuple(1.0, v_global));
     }
 
-    mrcpp::clear(xc_out, true);
+    this->mrdft->grid().recycle(xc_out);
 
     if (plevel == 2) {
         int totNodes = 0;
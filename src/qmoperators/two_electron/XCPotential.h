@@ -61,6 +61,11 @@ public:
             , energy(0.0)
             , orbitals(Phi)
             , mrdft(std::move(F)) {}
+    XCPotential(std::shared_ptr<mrdft::MRDFT> F, std::shared_ptr<OrbitalVector> Phi, bool mpi_shared)
+            : QMPotential(1, mpi_shared)
+            , energy(0.0)
+            , orbitals(Phi)
+            , mrdft(F) {}
     ~XCPotential() override = default;
 
     friend class XCOperator;
@@ -70,10 +75,10 @@ protected:
     std::vector<Density> densities;          ///< XC densities (total or alpha/beta)
     mrcpp::FunctionTreeVector<3> potentials; ///< XC Potential functions collected in a vector
     std::shared_ptr<OrbitalVector> orbitals; ///< External set of orbitals used to build the density
-    std::unique_ptr<mrdft::MRDFT> mrdft;     ///< External XC functional to be used
+    std::shared_ptr<mrdft::MRDFT> mrdft;     ///< External XC functional to be used (may be shared)
 
     double getEnergy() const { return this->energy; }
-    Density &getDensity(DensityType spin, int pert_idx);
+    virtual Density &getDensity(DensityType spin, int pert_idx);
     mrcpp::FunctionTree<3> &getPotential(int spin);
 
     void setup(double prec) override;
@@ -43,15 +43,86 @@ namespace mrchem {
 XCPotentialD2::XCPotentialD2(std::unique_ptr<mrdft::MRDFT> &F, std::shared_ptr<OrbitalVector> Phi, std::shared_ptr<OrbitalVector> X, std::shared_ptr<OrbitalVector> Y, bool mpi_shared)
         : XCPotential(F, Phi, mpi_shared)
         , orbitals_x(X)
-        , orbitals_y(Y) {
-    densities.push_back(Density(false)); // rho_0 total
-    densities.push_back(Density(false)); // rho_0 alpha
-    densities.push_back(Density(false)); // rho_0 beta
+        , orbitals_y(Y)
+        , unperturbed(std::make_shared<Unperturbed>()) {
+    unperturbed->densities.push_back(Density(false)); // rho_0 total
+    unperturbed->densities.push_back(Density(false)); // rho_0 alpha
+    unperturbed->densities.push_back(Density(false)); // rho_0 beta
+    densities.push_back(Density(false));              // unused, see getDensity
+    densities.push_back(Density(false));              // unused, see getDensity
+    densities.push_back(Density(false));              // unused, see getDensity
+    densities.push_back(Density(false));              // rho_1 total
+    densities.push_back(Density(false));              // rho_1 alpha
+    densities.push_back(Density(false));              // rho_1 beta
+    this->mrdft->setKernelCaching(true);
+}
+
+/** @brief Construct a potential for a different perturbation
+ *
+ * @param[in] ref Potential to share the XC functional and unperturbed density with
+ * @param[in] X 1st set of perturbed orbitals
+ * @param[in] Y 2nd set of perturbed orbitals
+ *
+ * The XC kernel cached in the functional and the unperturbed density are
+ * computed only once for all potentials sharing them. The potentials must
+ * be setup one at the time, which is the case within a FockBuilder.
+ */
+XCPotentialD2::XCPotentialD2(const XCPotentialD2 &ref, std::shared_ptr<OrbitalVector> X, std::shared_ptr<OrbitalVector> Y)
+        : XCPotential(ref.mrdft, ref.orbitals, ref.isShared())
+        , orbitals_x(X)
+        , orbitals_y(Y)
+        , unperturbed(ref.unperturbed) {
+    densities.push_back(Density(false)); // unused, see getDensity
+    densities.push_back(Density(false)); // unused, see getDensity
+    densities.push_back(Density(false)); // unused, see getDensity
     densities.push_back(Density(false)); // rho_1 total
     densities.push_back(Density(false)); // rho_1 alpha
     densities.push_back(Density(false)); // rho_1 beta
 }
 
+/** @brief Return the unperturbed (pert_idx = 0) or perturbed (pert_idx = 1) density
+ *
+ * The unperturbed densities are kept in the (shared) unperturbed state.
+ */
+Density &XCPotentialD2::getDensity(DensityType spin, int pert_idx) {
+    if (pert_idx != 0) return XCPotential::getDensity(spin, pert_idx);
+    int dens_idx = -1;
+    if (spin == DensityType::Total) dens_idx = 0;
+    if (spin == DensityType::Alpha) dens_idx = 1;
+    if (spin == DensityType::Beta) dens_idx = 2;
+    if (dens_idx < 0) NOT_IMPLEMENTED_ABORT;
+    return unperturbed->densities[dens_idx];
+}
+
+/** @brief Clears the perturbed density and the potential
+ *
+ * The unperturbed density, and the XC kernel cached in MRDFT,
+ * are kept for the next setup.
+ */
+void XCPotentialD2::clear() {
+    this->energy = 0.0;
+    getDensity(DensityType::Total, 1).free(NUMBER::Total);
+    getDensity(DensityType::Alpha, 1).free(NUMBER::Total);
+    getDensity(DensityType::Beta, 1).free(NUMBER::Total);
+    mrcpp::clear(this->potentials, true);
+    clearApplyPrec();
+}
+
+/** @brief Invalidate the unperturbed density if precision is insufficient
+ *
+ * If the requested precision is tighter than the one used to compute the
+ * current unperturbed density, it is recomputed and the cached XC kernel
+ * is discarded.
+ */
+void XCPotentialD2::setupUnperturbed(double prec) {
+    if (unperturbed->prec > 0.0 and prec >= unperturbed->prec) return;
+    getDensity(DensityType::Total, 0).free(NUMBER::Total);
+    getDensity(DensityType::Alpha, 0).free(NUMBER::Total);
+    getDensity(DensityType::Beta, 0).free(NUMBER::Total);
+    this->mrdft->clearKernelCache();
+    unperturbed->prec = prec;
+}
+
 /** @brief Prepare the operator for application
  *
  * @param[in] prec Apply precision
@@ -67,8 +138,11 @@ XCPotentialD2::XCPotentialD2(std::unique_ptr<mrdft::MRDFT> &F, std::shared_ptr<O
  * 7) Add extra grid nodes based on precision
  * 8) Clear internal functions in XCFunctional (density grid is kept)
  *
+ * The unperturbed density is only recomputed if the precision is tightened.
  */
 mrcpp::FunctionTreeVector<3> XCPotentialD2::setupDensities(double prec, mrcpp::FunctionTree<3> &grid) {
+    setupUnperturbed(prec);
+
     mrcpp::FunctionTreeVector<3> dens_vec;
     if (not this->mrdft->functional().isSpin()) {
         { // Unperturbed total density
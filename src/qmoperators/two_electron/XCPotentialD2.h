@@ -46,6 +46,15 @@
  *
  * LDA and GGA functionals are supported as well as two different ways to compute
  * the XC potentials: either with explicit derivatives or gamma-type derivatives.
+ *
+ * The unperturbed density and the XC kernel evaluated from it are kept between
+ * subsequent setup()/clear() cycles, since they are fixed during the response
+ * iterations. Only the perturbed density and potential are rebuilt, unless the
+ * requested precision is tighter than the one used for the unperturbed density.
+ *
+ * Several potentials for different perturbations (e.g. the Cartesian components
+ * of a field) can share the XC functional, and thereby the cached XC kernel, as
+ * well as the unperturbed density, by constructing them from a reference potential.
  */
 
 namespace mrchem {
@@ -53,11 +62,21 @@ namespace mrchem {
 class XCPotentialD2 final : public XCPotential {
 public:
     XCPotentialD2(std::unique_ptr<mrdft::MRDFT> &F, std::shared_ptr<OrbitalVector> Phi, std::shared_ptr<OrbitalVector> X, std::shared_ptr<OrbitalVector> Y, bool mpi_shared = false);
+    XCPotentialD2(const XCPotentialD2 &ref, std::shared_ptr<OrbitalVector> X, std::shared_ptr<OrbitalVector> Y);
 
 private:
+    struct Unperturbed {
+        std::vector<Density> densities; ///< Unperturbed densities (total, alpha, beta)
+        double prec{-1.0};              ///< Precision used for the (cached) unperturbed densities
+    };
+
     std::shared_ptr<OrbitalVector> orbitals_x; ///< 1st external set of perturbed orbitals used to build the density
     std::shared_ptr<OrbitalVector> orbitals_y; ///< 2nd external set of perturbed orbitals used to build the density
+    std::shared_ptr<Unperturbed> unperturbed;  ///< Unperturbed state, possibly shared with other potentials
 
+    Density &getDensity(DensityType spin, int pert_idx) override;
+    void clear() override;
+    void setupUnperturbed(double prec);
     mrcpp::FunctionTreeVector<3> setupDensities(double prec, mrcpp::FunctionTree<3> &grid);
 };
 
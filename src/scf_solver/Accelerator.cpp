@@ -23,6 +23,10 @@
  * <https://mrchem.readthedocs.io/>
  */
 
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
 #include <MRCPP/Printer>
 #include <MRCPP/Timer>
 
@@ -35,6 +39,8 @@ using mrcpp::Timer;
 
 namespace mrchem {
 
+int Accelerator::nInstances = 0;
+
 /** @brief constructor
  *
  * @param max: max length of history
@@ -44,7 +50,8 @@ namespace mrchem {
 Accelerator::Accelerator(int max, int min, bool sep)
         : minHistory(min)
         , maxHistory(max)
-        , sepOrbitals(sep) {
+        , sepOrbitals(sep)
+        , tag(nInstances++) {
     if (this->minHistory < 0) this->minHistory = 0;
     if (this->maxHistory < this->minHistory) MSG_ERROR("Invalid argument");
 }
@@ -55,13 +62,40 @@ Accelerator::Accelerator(int max, int min, bool sep)
  * ready for use in the next optimization.
  */
 void Accelerator::clear() {
+    for (int k = 0; k < this->storage.size(); k++) removeHistory(k);
+    this->storage.clear();
     while (this->orbitals.size() > 0) this->orbitals.pop_front();
     while (this->dOrbitals.size() > 0) this->dOrbitals.pop_front();
     while (this->fock.size() > 0) this->fock.pop_front();
     while (this->dFock.size() > 0) this->dFock.pop_front();
+    this->overlaps.clear();
+    this->staleOverlaps.clear();
     clearLinearSystem();
 }
 
+/** @brief Set up reduced storage of older iterations in history
+ *
+ * @param nMem: number of latest iterations kept in memory (negative: all)
+ * @param crop: precision of all but the latest iteration (negative: no cropping)
+ * @param path: directory for iterations that are not kept in memory
+ *
+ * Older iterations enter the linear system through differences with the
+ * latest iteration, which become small close to convergence. A cropping
+ * error larger than these differences would dominate the subspace, so the
+ * crop precision is never looser than the precision of the latest
+ * iteration (the prec argument of accelerate), and should in general be
+ * well below the orbital convergence threshold. Iterations beyond the
+ * latest nMem are written to disk by the owning MPI rank and read back
+ * only while they are needed. The directory must exist, and should
+ * preferably be node-local. The latest iteration is always kept in memory.
+ */
+void Accelerator::setHistoryStorage(int nMem, double crop, const std::string &path) {
+    if (nMem >= 0 and path.empty()) MSG_ERROR("No path given for history storage");
+    this->memHistory = (nMem < 0) ? -1 : std::max(nMem, 1);
+    this->cropPrec = crop;
+    this->storagePath = path;
+}
+
 /** @brief Delete the matrices and vectors used to compute the next step.
  *
  * The accelerator is now ready to move to the next iteration.
@@ -93,6 +127,11 @@ void Accelerator::rotate(const ComplexMatrix &U, bool all) {
     }
     if (nOrbs <= 0) { return; }
     for (int i = 0; i < nOrbs; i++) {
+        // Iterations on disk are rotated in memory and stored again below
+        loadHistory(i);
+        removeHistory(i);
+        this->storage[i].chkId = -1;
+
         auto &Phi = this->orbitals[i];
         mrcpp::mpifuncvec::rotate(Phi, U);
 
@@ -105,9 +144,117 @@ void Accelerator::rotate(const ComplexMatrix &U, bool all) {
         F = U.adjoint() * F * U;
         dF = U.adjoint() * dF * U;
     }
+    // Rotated history invalidates all cached inner products
+    this->overlaps.clear();
+    storeHistory();
     mrcpp::print::time(this->pl + 2, "Rotating iterative subspace", t_tot);
 }
 
+/** @brief Discard the oldest iterations in the history
+ *
+ * @param nKeep: number of iterations to keep
+ *
+ * Used to limit the cost (and memory) of rotating the history.
+ */
+void Accelerator::truncate(int nKeep) {
+    nKeep = std::max(nKeep, 0);
+    while (this->orbitals.size() > nKeep) popHistory();
+}
+
+/** @brief Write the orbital history to disk
+ *
+ * @param file: file name prefix
+ *
+ * Each iteration is written as two orbital sets ("<file>_<id>_phi" and
+ * "<file>_<id>_dphi", see orbital::save_orbitals), such that the history
+ * can be restored in a restarted calculation. Only iterations that are new
+ * (or rotated) since the last call are written, and the files of iterations
+ * that have left the history are deleted. Returns the file ids of the
+ * iterations in history, oldest first. Accelerators that include the Fock
+ * matrix in the subspace are not written, and will start over after restart.
+ */
+std::vector<int> Accelerator::writeCheckpoint(const std::string &file) {
+    std::vector<int> ids;
+    int nHistory = this->orbitals.size();
+    if (this->fock.size() > 0 or nHistory == 0) return ids;
+
+    for (int k = 0; k < nHistory; k++) {
+        auto &entry = this->storage[k];
+        if (entry.chkId < 0) {
+            entry.chkId = this->nCheckpoint++;
+            std::stringstream fname;
+            fname << file << "_" << entry.chkId;
+            loadHistory(k);
+            orbital::save_orbitals(this->orbitals[k], fname.str() + "_phi");
+            orbital::save_orbitals(this->dOrbitals[k], fname.str() + "_dphi");
+            releaseHistory(k);
+        }
+        ids.push_back(entry.chkId);
+    }
+
+    for (auto id : this->chkWritten) {
+        if (std::find(ids.begin(), ids.end(), id) != ids.end()) continue;
+        for (int n = 0; n < this->orbitals[nHistory - 1].size(); n++) {
+            if (not mrcpp::mpi::my_orb(this->orbitals[nHistory - 1][n])) continue;
+            for (const auto &u : {"_phi_idx_", "_dphi_idx_"}) {
+                std::stringstream fname;
+                fname << file << "_" << id << u << n;
+                std::remove((fname.str() + ".meta").c_str());
+                std::remove((fname.str() + "_re.tree").c_str());
+                std::remove((fname.str() + "_im.tree").c_str());
+            }
+        }
+    }
+    this->chkWritten = ids;
+    return ids;
+}
+
+/** @brief Read the orbital history from disk
+ *
+ * @param file: file name prefix
+ * @param ids: file ids of the iterations to read, oldest first
+ *
+ * Reads the files written by writeCheckpoint. The current history is
+ * discarded, and the inner products are recomputed in the next iteration.
+ * The files are kept, and are not written again by the next writeCheckpoint.
+ */
+void Accelerator::readCheckpoint(const std::string &file, const std::vector<int> &ids) {
+    clear();
+    for (int k = 0; k < ids.size(); k++) {
+        std::stringstream fname;
+        fname << file << "_" << ids[k];
+        this->orbitals.push_back(orbital::load_orbitals(fname.str() + "_phi"));
+        this->dOrbitals.push_back(orbital::load_orbitals(fname.str() + "_dphi"));
+        this->storage.push_back(HistoryStorage());
+        this->storage[k].chkId = ids[k];
+        this->nCheckpoint = std::max(this->nCheckpoint, ids[k] + 1);
+        if (this->orbitals[k].size() != this->orbitals[0].size()) MSG_ABORT("Invalid history checkpoint");
+        if (this->dOrbitals[k].size() != this->orbitals[0].size()) MSG_ABORT("Invalid history checkpoint");
+        storeHistory();
+    }
+    this->chkWritten = ids;
+}
+
+/** @brief Discard the oldest iteration in the history, including its files on disk */
+void Accelerator::popHistory() {
+    if (this->storage.size() > 0) {
+        removeHistory(0);
+        this->storage.pop_front();
+    }
+    if (this->orbitals.size() > 0) this->orbitals.pop_front();
+    if (this->dOrbitals.size() > 0) this->dOrbitals.pop_front();
+    if (this->fock.size() > 0) this->fock.pop_front();
+    if (this->dFock.size() > 0) this->dFock.pop_front();
+    for (auto &P_n : this->overlaps) {
+        if (P_n.rows() > 0) P_n = P_n.bottomRightCorner(P_n.rows() - 1, P_n.cols() - 1).eval();
+    }
+    std::vector<int> stale;
+    for (auto k : this->staleOverlaps) {
+        if (k > 0) stale.push_back(k - 1);
+    }
+    this->staleOverlaps = stale;
+}
+
 /** @brief Update iterative history with the latest orbitals and updates
  *
  * @param Phi: Next set of orbitals
@@ -129,10 +276,7 @@ void Accelerator::push_back(OrbitalVector &Phi, OrbitalVector &dPhi, ComplexMatr
         if (this->fock.size() != nHistory) MSG_ERROR("Size mismatch orbitals vs matrices");
     }
     auto historyIsFull = (nHistory >= this->maxHistory);
-    if (historyIsFull and this->orbitals.size() > 0) this->orbitals.pop_front();
-    if (historyIsFull and this->dOrbitals.size() > 0) this->dOrbitals.pop_front();
-    if (historyIsFull and this->fock.size() > 0) this->fock.pop_front();
-    if (historyIsFull and this->dFock.size() > 0) this->dFock.pop_front();
+    if (historyIsFull) popHistory();
 
     if (not verifyOverlap(Phi)) {
         println(this->pl + 2, " Clearing accelerator");
@@ -143,10 +287,141 @@ void Accelerator::push_back(OrbitalVector &Phi, OrbitalVector &dPhi, ComplexMatr
     this->dOrbitals.push_back(orbital::deep_copy(dPhi));
     if (F != nullptr) this->fock.push_back(*F);
     if (dF != nullptr) this->dFock.push_back(*dF);
+    this->storage.push_back(HistoryStorage());
+    storeHistory();
 
     mrcpp::print::time(this->pl + 2, "Push back orbitals", t_tot);
 }
 
+/** @brief Reduce the storage of all but the latest iterations in history
+ *
+ * Iterations are cropped to cropPrec (bounded by the precision of the
+ * latest iteration) once they are no longer the latest, and written to disk
+ * and freed once they fall outside the latest memHistory iterations. Only
+ * the owner of an orbital stores it. The cached inner products of a cropped
+ * iteration are marked stale and recomputed in the next updateOverlaps.
+ */
+void Accelerator::storeHistory() {
+    int nHistory = this->orbitals.size();
+    for (int k = 0; k < nHistory - 1; k++) {
+        auto &entry = this->storage[k];
+        if (entry.id >= 0) continue;
+
+        auto &Phi = this->orbitals[k];
+        auto &dPhi = this->dOrbitals[k];
+        int nOrbs = Phi.size();
+        if (this->cropPrec > 0.0 and not entry.cropped) {
+            double crop_prec = (this->orbPrec > 0.0) ? std::min(this->cropPrec, this->orbPrec) : this->cropPrec;
+            for (int n = 0; n < nOrbs; n++) {
+                if (not mrcpp::mpi::my_orb(Phi[n])) continue;
+                Phi[n].crop(crop_prec);
+                dPhi[n].crop(crop_prec);
+            }
+            entry.cropped = true;
+            this->staleOverlaps.push_back(k);
+        }
+
+        if (this->memHistory < 0 or k >= nHistory - this->memHistory) continue;
+        entry.id = this->nStored++;
+        entry.parts = std::vector<int>(2 * nOrbs, 0);
+        for (int n = 0; n < nOrbs; n++) {
+            if (not mrcpp::mpi::my_orb(Phi[n])) continue;
+            for (int u = 0; u < 2; u++) {
+                auto &func = (u == 0) ? Phi[n] : dPhi[n];
+                auto file = historyFile(entry.id, n, u);
+                int parts = 0;
+                if (func.hasReal()) {
+                    func.real().saveTree(file + "_re");
+                    parts |= 1;
+                }
+                if (func.hasImag()) {
+                    func.imag().saveTree(file + "_im");
+                    parts |= 2;
+                }
+                entry.parts[u * nOrbs + n] = parts;
+                func.free(NUMBER::Total);
+            }
+        }
+    }
+}
+
+/** @brief Read an iteration from disk back into memory (no-op if already in memory)
+ *
+ * @param k: position in history
+ */
+void Accelerator::loadHistory(int k) {
+    const auto &entry = this->storage[k];
+    if (entry.id < 0) return;
+
+    auto &Phi = this->orbitals[k];
+    auto &dPhi = this->dOrbitals[k];
+    int nOrbs = Phi.size();
+    for (int n = 0; n < nOrbs; n++) {
+        if (not mrcpp::mpi::my_orb(Phi[n])) continue;
+        for (int u = 0; u < 2; u++) {
+            auto &func = (u == 0) ? Phi[n] : dPhi[n];
+            if (func.hasReal() or func.hasImag()) continue;
+            auto file = historyFile(entry.id, n, u);
+            int parts = entry.parts[u * nOrbs + n];
+            if (parts & 1) {
+                func.alloc(NUMBER::Real);
+                func.real().loadTree(file + "_re");
+            }
+            if (parts & 2) {
+                func.alloc(NUMBER::Imag);
+                func.imag().loadTree(file + "_im");
+            }
+        }
+    }
+}
+
+/** @brief Free the memory of an iteration that is kept on disk (no-op if kept in memory)
+ *
+ * @param k: position in history
+ */
+void Accelerator::releaseHistory(int k) {
+    if (this->storage[k].id < 0) return;
+    for (auto &phi : this->orbitals[k]) phi.free(NUMBER::Total);
+    for (auto &phi : this->dOrbitals[k]) phi.free(NUMBER::Total);
+}
+
+/** @brief Delete the files of an iteration on disk
+ *
+ * @param k: position in history
+ *
+ * The iteration is marked as kept in memory, the orbitals must have been
+ * loaded first if they are still needed.
+ */
+void Accelerator::removeHistory(int k) {
+    auto &entry = this->storage[k];
+    if (entry.id < 0) return;
+
+    int nOrbs = entry.parts.size() / 2;
+    for (int n = 0; n < nOrbs; n++) {
+        for (int u = 0; u < 2; u++) {
+            int parts = entry.parts[u * nOrbs + n];
+            auto file = historyFile(entry.id, n, u);
+            if (parts & 1) std::remove((file + "_re.tree").c_str());
+            if (parts & 2) std::remove((file + "_im.tree").c_str());
+        }
+    }
+    entry.id = -1;
+    entry.parts.clear();
+}
+
+/** @brief File name prefix of an orbital (or update) of an iteration on disk
+ *
+ * The name contains the MPI rank and the instance tag of the accelerator,
+ * such that ranks and accelerators sharing the storage directory never
+ * write to the same file.
+ */
+std::string Accelerator::historyFile(int id, int n, bool update) const {
+    std::stringstream fname;
+    fname << this->storagePath << "/kain_" << mrcpp::mpi::wrk_rank << "_" << this->tag << "_" << id;
+    fname << ((update) ? "_dphi_" : "_phi_") << n;
+    return fname.str();
+}
+
 /** @brief Verify that the orbital overlap between the two last iterations is positive.
  *
  * @param Phi: Next set of orbitals
@@ -179,6 +454,80 @@ bool Accelerator::verifyOverlap(OrbitalVector &Phi) {
     return (out.sum() < 1) ? true : false;
 }
 
+/** @brief Complete the cache of inner products between orbitals and updates
+ *
+ * For each orbital n the matrix P_n(k,l) = <phi^k_n|f^l_n> is kept for all
+ * entries k,l in the history. Matrix elements are computed only for entries
+ * that are new since the last call, i.e. one new row and column for each
+ * iteration, and the oldest row and column are removed when the history is
+ * truncated. Rows and columns of iterations that have been cropped since
+ * the last call are recomputed. Only the owner of an orbital computes its
+ * matrix, the other MPI ranks keep zeros. Iterations kept on disk are read
+ * only if some of their inner products need to be (re)computed.
+ *
+ * With residualOverlaps the matrix P_n(k,l) = <f^k_n|f^l_n> between the
+ * updates is kept instead. This is Hermitian, and only the upper triangle
+ * is computed.
+ */
+void Accelerator::updateOverlaps() {
+    Timer t_tot;
+    int nHistory = this->orbitals.size();
+    int nOrbs = (nHistory > 0) ? this->orbitals[nHistory - 1].size() : 0;
+    if (this->overlaps.size() != nOrbs) this->overlaps = std::vector<ComplexMatrix>(nOrbs);
+
+    int nMin = nHistory;
+    std::vector<int> nOld(nOrbs);
+    for (int n = 0; n < nOrbs; n++) {
+        auto &P_n = this->overlaps[n];
+        nOld[n] = P_n.rows();
+        nMin = std::min(nMin, nOld[n]);
+        P_n.conservativeResize(nHistory, nHistory);
+        if (not mrcpp::mpi::my_orb(this->orbitals[nHistory - 1][n])) P_n.setZero();
+    }
+
+    std::vector<bool> stale(nHistory, false);
+    for (auto k : this->staleOverlaps) {
+        if (k < nHistory) stale[k] = true;
+    }
+    this->staleOverlaps.clear();
+
+    auto needsUpdate = [&](int k, int l) {
+        if (this->residualOverlaps and l < k) return false;
+        return (k >= nMin or l >= nMin or stale[k] or stale[l]);
+    };
+
+    // Iterations are looped in the outer loops, such that each iteration
+    // on disk is read only once (unless the cache has been invalidated)
+    for (int k = 0; k < nHistory; k++) {
+        bool needed = false;
+        for (int l = 0; l < nHistory; l++) needed = (needed or needsUpdate(k, l));
+        if (not needed) continue;
+
+        loadHistory(k);
+        for (int l = 0; l < nHistory; l++) {
+            if (not needsUpdate(k, l)) continue;
+            bool recompute = (stale[k] or stale[l]);
+            if (l != k) loadHistory(l);
+            for (int n = 0; n < nOrbs; n++) {
+                if (k < nOld[n] and l < nOld[n] and not recompute) continue;
+                if (not mrcpp::mpi::my_orb(this->orbitals[nHistory - 1][n])) continue;
+                auto &bra = (this->residualOverlaps) ? this->dOrbitals[k][n] : this->orbitals[k][n];
+                this->overlaps[n](k, l) = orbital::dot(bra, this->dOrbitals[l][n]);
+            }
+            if (l != k) releaseHistory(l);
+        }
+        releaseHistory(k);
+    }
+    if (this->residualOverlaps) {
+        for (auto &P_n : this->overlaps) {
+            for (int k = 0; k < nHistory; k++) {
+                for (int l = 0; l < k; l++) P_n(k, l) = std::conj(P_n(l, k));
+            }
+        }
+    }
+    mrcpp::print::time(this->pl + 2, "Update inner products", t_tot);
+}
+
 /** @brief Calculates the new orbitals and updates based on history information
  *
  * @param prec: Precision used in arithmetic operations
@@ -203,6 +552,7 @@ void Accelerator::accelerate(double prec, OrbitalVector &Phi, OrbitalVector &dPh
     mrcpp::print::header(this->pl + 2, "Iterative subspace accelerator");
 
     // Deep copy into history
+    this->orbPrec = prec;
     this->push_back(Phi, dPhi, F, dF);
 
     int nHistory = this->orbitals.size() - 1;
@@ -246,7 +596,9 @@ void Accelerator::copyOrbitals(OrbitalVector &Phi, int nHistory) {
     int totHistory = this->orbitals.size();
     if (nHistory >= totHistory or nHistory < 0) MSG_ABORT("Requested orbitals unavailable");
     int n = totHistory - 1 - nHistory;
+    loadHistory(n);
     Phi = orbital::deep_copy(this->orbitals[n]);
+    releaseHistory(n);
     mrcpp::print::time(this->pl + 2, "Copy orbitals", t_tot);
 }
 
@@ -262,7 +614,9 @@ void Accelerator::copyOrbitalUpdates(OrbitalVector &dPhi, int nHistory) {
     int totHistory = this->dOrbitals.size();
     if (nHistory >= totHistory or nHistory < 0) MSG_ABORT("Requested orbitals unavailable");
     int n = totHistory - 1 - nHistory;
+    loadHistory(n);
     dPhi = orbital::deep_copy(this->dOrbitals[n]);
+    releaseHistory(n);
     mrcpp::print::time(this->pl + 2, "Copy orbital updates", t_tot);
 }
 
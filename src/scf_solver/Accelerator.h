@@ -26,6 +26,7 @@
 #pragma once
 
 #include <deque>
+#include <string>
 #include <vector>
 
 #include "mrchem.h"
@@ -48,6 +49,12 @@
  *  also possible to include the Fock matrix and corresponding update
  *  to the subspace. In this case one entry is added (corresponding to
  *  an extra orbital) using the Frobenius inner product of matrices.
+ *
+ *  To limit the memory footprint, older iterations in the history can
+ *  optionally be cropped to a looser precision, and all but the latest
+ *  iterations can be spilled to (node-local) disk. Spilled iterations
+ *  are read back one at a time when they are needed in the construction
+ *  of the linear system or the expansion of the solution.
  */
 
 namespace mrchem {
@@ -61,6 +68,7 @@ public:
     void setLocalPrintLevel(int p) { this->pl = p; }
     void setMaxHistory(int max) { this->maxHistory = max; }
     void setMinHistory(int min) { this->minHistory = min; }
+    void setHistoryStorage(int nMem, double crop, const std::string &path);
 
     // clang-format off
     void accelerate(double prec,
@@ -77,6 +85,9 @@ public:
     void replaceOrbitalUpdates(OrbitalVector &dPhi, int nHistory = 0);
 
     void rotate(const ComplexMatrix &U, bool all = true);
+    void truncate(int nKeep);
+    std::vector<int> writeCheckpoint(const std::string &file);
+    void readCheckpoint(const std::string &file, const std::vector<int> &ids);
     void printSizeNodes() const;
 
 protected:
@@ -94,7 +105,38 @@ protected:
     std::deque<ComplexMatrix> fock;      ///< Fock history
     std::deque<ComplexMatrix> dFock;     ///< Fock update history
 
+    bool residualOverlaps{false};        ///< Cache <f_k|f_l> instead of <phi_k|f_l>
+    std::vector<ComplexMatrix> overlaps; ///< Cached <phi_k|f_l> over the history, one matrix per orbital
+
+    struct HistoryStorage {
+        int id{-1};             ///< File id of iteration on disk (negative: in memory)
+        int chkId{-1};          ///< File id of iteration in checkpoint (negative: not written)
+        bool cropped{false};    ///< Iteration has been cropped to cropPrec
+        std::vector<int> parts; ///< Real (1) and imaginary (2) parts of the functions on disk
+    };
+
+    int memHistory{-1};                 ///< Number of latest iterations kept in memory (negative: all)
+    int nStored{0};                     ///< Number of iterations spilled to disk so far
+    double cropPrec{-1.0};              ///< Precision of older iterations (negative: no cropping)
+    double orbPrec{-1.0};               ///< Precision of the latest iteration, bounds the cropping
+    std::vector<int> staleOverlaps;     ///< Iterations cropped after their inner products were cached
+    std::string storagePath;            ///< Directory of iterations spilled to disk
+    int tag;                            ///< Instance tag, keeps the history files of accelerators apart
+    std::deque<HistoryStorage> storage; ///< Storage state of each iteration in history
+    int nCheckpoint{0};                 ///< Number of iterations written to checkpoint so far
+    std::vector<int> chkWritten;        ///< File ids of iterations currently in checkpoint
+
+    static int nInstances; ///< Number of accelerators constructed so far, used for tags
+
     bool verifyOverlap(OrbitalVector &phi);
+    void updateOverlaps();
+
+    void popHistory();
+    void storeHistory();
+    void loadHistory(int k);
+    void releaseHistory(int k);
+    void removeHistory(int k);
+    std::string historyFile(int id, int n, bool update) const;
 
     // clang-format off
     void push_back(OrbitalVector &phi,
@@ -0,0 +1,184 @@
+/*
+ * MRChem, a numerical real-space code for molecular electronic structure
+ * calculations within the self-consistent field (SCF) approximations of quantum
+ * chemistry (Hartree-Fock and Density Functional Theory).
+ * Copyright (C) 2023 Stig Rune Jensen, Luca Frediani, Peter Wind and contributors.
+ *
+ * This file is part of MRChem.
+ *
+ * MRChem is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MRChem is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with MRChem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * For information on the complete list of contributors to MRChem, see:
+ * <https://mrchem.readthedocs.io/>
+ */
+
+#include <MRCPP/Parallel>
+#include <MRCPP/Printer>
+#include <MRCPP/Timer>
+
+#include "DIIS.h"
+#include "qmfunctions/Orbital.h"
+#include "qmfunctions/orbital_utils.h"
+
+using mrcpp::Printer;
+using mrcpp::Timer;
+
+namespace mrchem {
+
+/** @brief constructor
+ *
+ * @param max: max length of history
+ * @param min: min length of history
+ *
+ * All orbitals share the same subspace coefficients.
+ */
+DIIS::DIIS(int max, int min)
+        : Accelerator(max, min, false) {
+    this->residualOverlaps = true;
+}
+
+/** @brief Calculates the (single) A matrix and b vector of the subspace problem
+ *
+ * \f$ B_{ij} = \sum_n \langle f(x^i_n) | f(x^j_n) \rangle \f$
+ *
+ * including the Frobenius inner product of the Fock matrix updates, if
+ * present. The constraint \f$ \sum_i c_i = 1 \f$ is imposed through a
+ * Lagrange multiplier, giving the bordered system
+ *
+ * \f$ \begin{pmatrix} B & -1 \\ -1 & 0 \end{pmatrix}
+ *     \begin{pmatrix} c \\ \lambda \end{pmatrix} =
+ *     \begin{pmatrix} 0 \\ -1 \end{pmatrix} \f$
+ *
+ * The inner products are taken from the cache (see updateOverlaps), such
+ * that only one new column needs to be computed in each iteration.
+ */
+void DIIS::setupLinearSystem() {
+    Timer t_tot;
+    int nHistory = this->orbitals.size();
+    if (nHistory < 2) MSG_ABORT("Not enough history to setup system of equations");
+
+    updateOverlaps();
+
+    int nOrbitals = this->orbitals[nHistory - 1].size();
+    ComplexMatrix B = ComplexMatrix::Zero(nHistory, nHistory);
+    for (int n = 0; n < nOrbitals; n++) {
+        if (mrcpp::mpi::my_orb(this->orbitals[nHistory - 1][n])) B += this->overlaps[n];
+    }
+    mrcpp::mpi::allreduce_matrix(B, mrcpp::mpi::comm_wrk);
+
+    // Fock matrix is treated as a whole using the Frobenius inner product
+    if (this->orbitals.size() == this->fock.size()) {
+        for (int i = 0; i < nHistory; i++) {
+            for (int j = 0; j < nHistory; j++) {
+                auto prod = this->dFock[i].adjoint() * this->dFock[j];
+                B(i, j) += prod.trace();
+            }
+        }
+    }
+
+    // Scale by the largest diagonal element (a single factor, the solution c
+    // is unchanged) to keep the matrix elements on the scale of the constraints
+    double scale = B.diagonal().real().maxCoeff();
+    if (scale > 0.0) B /= scale;
+
+    ComplexMatrix A_mat = ComplexMatrix::Zero(nHistory + 1, nHistory + 1);
+    A_mat.topLeftCorner(nHistory, nHistory) = B;
+    A_mat.block(0, nHistory, nHistory, 1).setConstant(-1.0);
+    A_mat.block(nHistory, 0, 1, nHistory).setConstant(-1.0);
+
+    ComplexVector b_vec = ComplexVector::Zero(nHistory + 1);
+    b_vec(nHistory) = -1.0;
+
+    this->A.push_back(A_mat);
+    this->b.push_back(b_vec);
+    mrcpp::print::time(this->pl + 2, "Setup linear system", t_tot);
+}
+
+/** @brief Compute the next step for orbitals and orbital updates
+ *
+ * The next step \f$ \delta x^m \f$ is constructed from the solution
+ * \f$ c \f$ of the linear problem as:
+ *
+ * \f$ \delta x^m = \sum_{i} c_i(x^i + f(x^i)) - x^m \f$
+ *
+ * such that each orbital is obtained from a single linear combination
+ * with coefficients that are shared by all orbitals.
+ */
+void DIIS::expandSolution(double prec, OrbitalVector &Phi, OrbitalVector &dPhi, ComplexMatrix *F, ComplexMatrix *dF) {
+    Timer t_tot;
+    int nHistory = this->orbitals.size() - 1;
+    int nOrbitals = this->orbitals[nHistory].size();
+    const auto &c_vec = this->c[0];
+
+    // Latest iteration, including the subtraction of the current orbitals
+    std::vector<std::vector<ComplexDouble>> totCoefs(nOrbitals);
+    std::vector<std::vector<mrcpp::ComplexFunction>> totOrbs(nOrbitals);
+    for (int n = 0; n < nOrbitals; n++) {
+        if (not mrcpp::mpi::my_orb(Phi[n])) continue;
+        totCoefs[n].push_back(c_vec(nHistory) - 1.0);
+        totOrbs[n].push_back(this->orbitals[nHistory][n]);
+        totCoefs[n].push_back(c_vec(nHistory));
+        totOrbs[n].push_back(this->dOrbitals[nHistory][n]);
+    }
+
+    // Iterations kept on disk are collected into a partial sum while
+    // they are loaded, the others enter the final linear combination
+    for (int j = 0; j < nHistory; j++) {
+        loadHistory(j);
+        bool onDisk = (this->storage[j].id >= 0);
+        for (int n = 0; n < nOrbitals; n++) {
+            if (not mrcpp::mpi::my_orb(Phi[n])) continue;
+            auto &phi_j = this->orbitals[j][n];
+            auto &fPhi_j = this->dOrbitals[j][n];
+            if (onDisk) {
+                auto partStep = phi_j.paramCopy();
+                mrcpp::cplxfunc::add(partStep, c_vec(j), phi_j, c_vec(j), fPhi_j, prec);
+                totCoefs[n].push_back({1.0, 0.0});
+                totOrbs[n].push_back(partStep);
+            } else {
+                totCoefs[n].push_back(c_vec(j));
+                totOrbs[n].push_back(phi_j);
+                totCoefs[n].push_back(c_vec(j));
+                totOrbs[n].push_back(fPhi_j);
+            }
+        }
+        releaseHistory(j);
+    }
+
+    // Orbitals are unchanged, updates are overwritten
+    dPhi = orbital::param_copy(this->dOrbitals[nHistory]);
+    for (int n = 0; n < nOrbitals; n++) {
+        if (not mrcpp::mpi::my_orb(Phi[n])) continue;
+
+        // std::vector -> ComplexVector
+        ComplexVector coefsVec(totCoefs[n].size());
+        for (int i = 0; i < totCoefs[n].size(); i++) coefsVec(i) = totCoefs[n][i];
+
+        dPhi[n] = Phi[n].paramCopy();
+        mrcpp::cplxfunc::linear_combination(dPhi[n], coefsVec, totOrbs[n], prec);
+    }
+
+    // Fock matrix is extrapolated with the same coefficients
+    if (this->fock.size() == this->orbitals.size()) {
+        if (F == nullptr or dF == nullptr) MSG_ERROR("Invalid fock matrix");
+
+        ComplexMatrix fockStep = -this->fock[nHistory];
+        for (int j = 0; j <= nHistory; j++) fockStep += c_vec(j) * (this->fock[j] + this->dFock[j]);
+        // F is unchanged, dF is overwritten
+        *dF = fockStep;
+    }
+    mrcpp::print::time(this->pl + 2, "Expand solution", t_tot);
+}
+
+} // namespace mrchem
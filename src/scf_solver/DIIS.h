@@ -0,0 +1,64 @@
+/*
+ * MRChem, a numerical real-space code for molecular electronic structure
+ * calculations within the self-consistent field (SCF) approximations of quantum
+ * chemistry (Hartree-Fock and Density Functional Theory).
+ * Copyright (C) 2023 Stig Rune Jensen, Luca Frediani, Peter Wind and contributors.
+ *
+ * This file is part of MRChem.
+ *
+ * MRChem is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MRChem is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with MRChem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * For information on the complete list of contributors to MRChem, see:
+ * <https://mrchem.readthedocs.io/>
+ */
+
+#pragma once
+
+#include "Accelerator.h"
+
+/** @class DIIS
+ *
+ * This class implements the Direct Inversion in the Iterative Subspace (DIIS)
+ * method of P. Pulay (Chem. Phys. Lett. 73, 393, 1980), using the orbital
+ * updates of each iteration as error vectors.
+ *
+ * The next iterate is extrapolated as
+ *
+ * \f$ x^{n+1} = \sum_i c_i (x^i + f(x^i)) \f$
+ *
+ * where the coefficients minimize the norm of the combined update
+ * \f$ \| \sum_i c_i f(x^i) \| \f$ under the constraint \f$ \sum_i c_i = 1 \f$.
+ * In contrast to KAIN a single coefficient vector is shared by all orbitals
+ * (and the Fock matrix, if included), and only the inner products between
+ * the updates are needed.
+ */
+
+namespace mrchem {
+
+class DIIS final : public Accelerator {
+public:
+    DIIS(int max, int min = 0);
+
+protected:
+    void setupLinearSystem() override;
+    // clang-format off
+    void expandSolution(double prec,
+                        OrbitalVector &Phi,
+                        OrbitalVector &dPhi,
+                        ComplexMatrix *F,
+                        ComplexMatrix *dF) override;
+    // clang-format on
+};
+
+} // namespace mrchem
@@ -23,9 +23,15 @@
  * <https://mrchem.readthedocs.io/>
  */
 
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+#include <MRCPP/Parallel>
 #include <MRCPP/Printer>
 #include <MRCPP/Timer>
 
+#include "DIIS.h"
 #include "GroundStateSolver.h"
 #include "HelmholtzVector.h"
 #include "KAIN.h"
@@ -36,6 +42,7 @@
 #include "qmoperators/one_electron/ZoraOperator.h"
 #include "qmoperators/two_electron/FockBuilder.h"
 #include "qmoperators/two_electron/ReactionOperator.h"
+#include "utils/math_utils.h"
 
 using mrcpp::Printer;
 using mrcpp::Timer;
@@ -135,7 +142,7 @@ void GroundStateSolver::printParameters(const std::string &calculation) const {
 
     std::stringstream o_kain;
     if (this->history > 0) {
-        o_kain << this->history;
+        o_kain << ((this->accelerator == "diis") ? "DIIS, " : "KAIN, ") << this->history;
     } else {
         o_kain << "Off";
     }
@@ -202,6 +209,8 @@ void GroundStateSolver::printParameters(const std::string &calculation) const {
     print_utils::text(0, "KAIN solver        ", o_kain.str());
     print_utils::text(0, "Localization       ", o_loc.str());
     print_utils::text(0, "Diagonalization    ", o_diag.str());
+    print_utils::text(0, "Orbital freezing   ", (this->freeze) ? "On" : "Off");
+    print_utils::text(0, "Orthonormalization ", (this->orthoOnce) ? "Once per iteration" : "Twice per iteration");
     print_utils::text(0, "Start precision    ", o_prec_0.str());
     print_utils::text(0, "Final precision    ", o_prec_1.str());
     print_utils::text(0, "Helmholtz precision", o_helm.str());
@@ -214,6 +223,7 @@ void GroundStateSolver::printParameters(const std::string &calculation) const {
 void GroundStateSolver::reset() {
     SCFSolver::reset();
     this->energy.clear();
+    unfreezeOrbitals();
 }
 
 /** @brief Run orbital optimization
@@ -230,13 +240,15 @@ void GroundStateSolver::reset() {
  *
  *  1) Diagonalize/localize orbitals
  *  2) Compute current SCF energy
- *  3) Apply Helmholtz operator on all orbitals
- *  4) Orthonormalize orbitals (Löwdin)
+ *  3) Apply Helmholtz operator on all (non-frozen) orbitals
+ *  4) Orthonormalize orbitals (Löwdin), or normalize only (orthonormalize_once)
  *  5) Compute orbital updates
- *  6) Compute KAIN update
- *  7) Compute errors and check for convergence
+ *  6) Compute KAIN update (non-frozen orbitals)
+ *  7) Compute errors, freeze/unfreeze orbitals and check for convergence
  *  8) Add orbital updates
- *  9) Orthonormalize orbitals (Löwdin)
+ *  9) Orthonormalize orbitals (Löwdin), or with orthonormalize_once, project
+ *     the updates onto the orthogonal complement of the orbitals and
+ *     orthonormalize in a single rotation (see calcOrthonormalUpdate)
  * 10) Setup Fock operator
  * 11) Compute Fock matrix
  *
@@ -253,23 +265,38 @@ json GroundStateSolver::optimize(Molecule &mol, FockBuilder &F) {
     ComplexMatrix &F_mat = mol.getFockMatrix();
 
     auto scaling = std::vector<double>(Phi_n.size(), 1.0);
-    KAIN kain(this->history, 0, false, scaling);
+    std::unique_ptr<Accelerator> kain;
+    if (this->accelerator == "kain") {
+        kain = std::make_unique<KAIN>(this->history, 0, false, scaling);
+    } else if (this->accelerator == "diis") {
+        kain = std::make_unique<DIIS>(this->history);
+    } else {
+        MSG_ABORT("Invalid accelerator");
+    }
+    kain->setHistoryStorage(this->memHistory, this->cropHistory, this->pathHistory);
 
+    this->frozen = std::vector<bool>(Phi_n.size(), false);
+    this->frozenError = DoubleVector::Zero(Phi_n.size());
+    this->frozenFock = ComplexMatrix::Zero(Phi_n.size(), Phi_n.size());
+    std::vector<int> prev_active = getActiveOrbitals();
+
+    int nIter = 0;
     DoubleVector errors = DoubleVector::Ones(Phi_n.size());
+    if (not this->readChkState or not readState(nIter, errors, *kain)) {
+        this->error.push_back(errors.norm());
+        this->energy.push_back(E_n);
+        this->property.push_back(E_n.getTotalEnergy());
+    }
     double err_o = errors.maxCoeff();
     double err_t = errors.norm();
-
-    this->error.push_back(err_t);
-    this->energy.push_back(E_n);
-    this->property.push_back(E_n.getTotalEnergy());
+    int nStart = nIter;
 
     auto plevel = Printer::getPrintLevel();
     if (plevel < 1) {
         printConvergenceHeader("Total energy");
-        printConvergenceRow(0);
+        printConvergenceRow(nStart);
     }
 
-    int nIter = 0;
     bool converged = false;
     json_out["cycles"] = {};
     while (nIter++ < this->maxIter or this->maxIter < 0) {
@@ -283,41 +310,92 @@ json GroundStateSolver::optimize(Molecule &mol, FockBuilder &F) {
         Timer t_scf;
         double orb_prec = adjustPrecision(err_o);
         double helm_prec = getHelmholtzPrec();
-        if (nIter < 2) {
+        json_cycle["iteration"] = nIter;
+        json_cycle["orbital_prec"] = orb_prec;
+        if (nIter == nStart + 1) {
             if (F.getReactionOperator() != nullptr) F.getReactionOperator()->updateMOResidual(err_t);
             F.setup(orb_prec);
         }
 
+        // Frozen orbitals are excluded from the Helmholtz and KAIN updates
+        std::vector<int> active = getActiveOrbitals();
+        bool all_active = (active.size() == Phi_n.size());
+        if (active != prev_active) kain->clear();
+        prev_active = active;
+
         // Init Helmholtz operator
-        HelmholtzVector H(helm_prec, F_mat.real().diagonal());
-        ComplexMatrix L_mat = H.getLambdaMatrix();
+        DoubleVector F_diag = F_mat.real().diagonal();
+        DoubleVector F_active(active.size());
+        for (int k = 0; k < active.size(); k++) F_active(k) = F_diag(active[k]);
+        HelmholtzVector H(helm_prec, F_active);
+        DoubleMatrix L_active = H.getLambdaMatrix();
+        ComplexMatrix L_mat = ComplexMatrix::Zero(Phi_n.size(), Phi_n.size());
+        for (int k = 0; k < active.size(); k++) L_mat(active[k], active[k]) = L_active(k, k);
 
         // Apply Helmholtz operator
-        OrbitalVector Psi = F.buildHelmholtzArgument(orb_prec, Phi_n, F_mat, L_mat);
-        OrbitalVector Phi_np1 = H(Psi);
+        OrbitalVector Psi = F.buildHelmholtzArgument(orb_prec, Phi_n, F_mat, L_mat, (all_active) ? std::vector<int>() : active);
+        OrbitalVector Phi_act = H(Psi);
         Psi.clear();
         F.clear();
 
-        // Orthonormalize
-        orbital::orthonormalize(orb_prec, Phi_np1, F_mat);
+        // Frozen orbitals are copied from the previous iteration
+        OrbitalVector Phi_np1 = orbital::param_copy(Phi_n);
+        for (int i = 0; i < Phi_n.size(); i++) {
+            if (this->frozen[i] and mrcpp::mpi::my_orb(Phi_np1[i])) mrcpp::cplxfunc::deep_copy(Phi_np1[i], Phi_n[i]);
+        }
+        for (int k = 0; k < active.size(); k++) Phi_np1[active[k]] = Phi_act[k];
+        Phi_act.clear();
+
+        // Orthonormalize, or only normalize if this is postponed until after the
+        // KAIN step
+        if (this->orthoOnce) {
+            orbital::normalize(Phi_np1);
+        } else {
+            orbital::orthonormalize(orb_prec, Phi_np1, F_mat);
+        }
 
         // Compute orbital updates
         OrbitalVector dPhi_n = orbital::add(1.0, Phi_np1, -1.0, Phi_n);
         Phi_np1.clear();
 
-        kain.accelerate(orb_prec, Phi_n, dPhi_n);
+
+        if (all_active) {
+            kain->accelerate(orb_prec, Phi_n, dPhi_n);
+        } else if (not active.empty()) {
+            OrbitalVector Phi_kain, dPhi_kain;
+            for (auto i : active) {
+                Phi_kain.push_back(Phi_n[i]);
+                dPhi_kain.push_back(dPhi_n[i]);
+            }
+            kain->accelerate(orb_prec, Phi_kain, dPhi_kain);
+            for (int k = 0; k < active.size(); k++) dPhi_n[active[k]] = dPhi_kain[k];
+        }
 
         // Compute errors
-        errors = orbital::get_norms(dPhi_n);
+        ComplexMatrix U_once;
+        OrbitalVector Phi_dPhi;
+        if (this->orthoOnce) {
+            U_once = calcOrthonormalUpdate(Phi_n, dPhi_n, Phi_dPhi, errors);
+        } else {
+            errors = orbital::get_norms(dPhi_n);
+        }
+        updateFrozenOrbitals(errors, F_mat);
         err_o = errors.maxCoeff();
         err_t = errors.norm();
         json_cycle["mo_residual"] = err_t;
 
         // Update orbitals
-        Phi_n = orbital::add(1.0, Phi_n, 1.0, dPhi_n);
-        dPhi_n.clear();
-
-        orbital::orthonormalize(orb_prec, Phi_n, F_mat);
+        if (this->orthoOnce) {
+            Timer t_rot;
+            mrcpp::mpifuncvec::rotate(Phi_dPhi, U_once, orb_prec);
+            for (int i = 0; i < U_once.cols() / 2; i++) Phi_n.push_back(Phi_dPhi[i]);
+            Phi_dPhi.clear();
+            mrcpp::print::time(2, "Rotating orbitals", t_rot);
+        } else {
+            Phi_n = orbital::add(1.0, Phi_n, 1.0, dPhi_n);
+            dPhi_n.clear();
+            orbital::orthonormalize(orb_prec, Phi_n, F_mat);
+        }
 
         // Compute Fock matrix and energy
         if (F.getReactionOperator() != nullptr) F.getReactionOperator()->updateMOResidual(err_t);
@@ -340,15 +418,18 @@ json GroundStateSolver::optimize(Molecule &mol, FockBuilder &F) {
         if (needLocalization(nIter, converged)) {
             ComplexMatrix U_mat = orbital::localize(orb_prec, Phi_n, F_mat);
             F.rotate(U_mat);
-            kain.clear();
+            rotateSubspace(*kain, U_mat, all_active);
+            unfreezeOrbitals();
         } else if (needDiagonalization(nIter, converged)) {
             ComplexMatrix U_mat = orbital::diagonalize(orb_prec, Phi_n, F_mat);
             F.rotate(U_mat);
-            kain.clear();
+            rotateSubspace(*kain, U_mat, all_active);
+            unfreezeOrbitals();
         }
 
         // Save checkpoint file
         if (this->checkpoint) orbital::save_orbitals(Phi_n, this->chkFile);
+        if (this->checkpoint and this->writeChkState) writeState(nIter, errors, *kain, all_active);
 
         // Finalize SCF cycle
         if (plevel < 1) printConvergenceRow(nIter);
@@ -428,4 +509,217 @@ bool GroundStateSolver::needDiagonalization(int nIter, bool converged) const {
     return diag;
 }
 
+/** @brief Indices of the orbitals that are not frozen */
+std::vector<int> GroundStateSolver::getActiveOrbitals() const {
+    std::vector<int> active;
+    for (int i = 0; i < this->frozen.size(); i++) {
+        if (not this->frozen[i]) active.push_back(i);
+    }
+    return active;
+}
+
+/** @brief Update the set of frozen orbitals
+ *
+ * @param errors: orbital residuals of the current iteration
+ * @param F_mat: Fock matrix used in the current iteration
+ *
+ * The residual of a frozen orbital is not available, since the Helmholtz
+ * operator is not applied. It is estimated as the residual at the time of
+ * freezing plus the change in its row of the Fock matrix since then, and
+ * this estimate replaces the residual in the convergence check.
+ *
+ * Orbitals are frozen when the residual is below 1/10 of the orbital threshold,
+ * and unfrozen when the estimate exceeds 1/2 of the threshold. Changes take
+ * effect in the next iteration. Freezing is only done at the final precision,
+ * since frozen orbitals are not refined further, and only if an orbital
+ * threshold is given.
+ */
+void GroundStateSolver::updateFrozenOrbitals(DoubleVector &errors, const ComplexMatrix &F_mat) {
+    int nOrbs = errors.size();
+    bool final_prec = (this->orbPrec[0] <= this->orbPrec[2]);
+    if (not this->freeze or not final_prec or this->orbThrs < 0.0) {
+        unfreezeOrbitals();
+        return;
+    }
+
+    for (int i = 0; i < nOrbs; i++) {
+        if (this->frozen[i]) {
+            double drift = (F_mat.row(i) - this->frozenFock.row(i)).norm();
+            errors(i) = std::max(errors(i), this->frozenError(i) + drift);
+            if (errors(i) > 0.5 * this->orbThrs) this->frozen[i] = false;
+        } else if (errors(i) < 0.1 * this->orbThrs) {
+            this->frozen[i] = true;
+            this->frozenError(i) = errors(i);
+            this->frozenFock.row(i) = F_mat.row(i);
+        }
+    }
+
+    // Keep at least one orbital active, otherwise nothing is updated
+    int nFrozen = std::count(this->frozen.begin(), this->frozen.end(), true);
+    if (nFrozen == nOrbs) {
+        unfreezeOrbitals();
+        nFrozen = 0;
+    }
+    mrcpp::print::value(2, "Frozen orbitals", nFrozen, "", 0, false);
+}
+
+/** @brief Unfreeze all orbitals, e.g. after orbital rotations */
+void GroundStateSolver::unfreezeOrbitals() {
+    std::fill(this->frozen.begin(), this->frozen.end(), false);
+}
+
+/** @brief Rotate the KAIN history along with the orbitals
+ *
+ * @param kain: iterative subspace accelerator
+ * @param U: orbital rotation matrix
+ * @param all_active: KAIN history contains all orbitals (none frozen)
+ *
+ * The stored orbitals, updates and Fock matrices are rotated with the same
+ * matrix as the current orbitals, such that the iterative subspace survives
+ * localization/diagonalization. Since each stored iteration is as expensive
+ * to rotate as the orbitals themselves, the history can be truncated to the
+ * latest rotateHistory iterations first. The history is cleared if it only
+ * covers a subset of the orbitals (some orbitals frozen).
+ */
+void GroundStateSolver::rotateSubspace(Accelerator &kain, const ComplexMatrix &U, bool all_active) {
+    if (this->rotateHistory == 0 or not all_active) {
+        kain.clear();
+        return;
+    }
+    if (this->rotateHistory > 0) kain.truncate(this->rotateHistory);
+    kain.rotate(U, true);
+}
+
+/** @brief Combined projection and orthonormalization of the orbital updates
+ *
+ * @param Phi: current (orthonormal) orbitals, moved into Phi_dPhi
+ * @param dPhi: orbital updates, moved into Phi_dPhi
+ * @param Phi_dPhi: adjoined vector (Phi, dPhi) to be rotated (out)
+ * @param errors: norms of the projected updates (out)
+ *
+ * The update is projected onto the orthogonal complement of the orbitals,
+ * Q = dPhi - Phi*A with A = <Phi|dPhi>, and the updated orbitals are
+ * Löwdin orthonormalized, Phi' = (Phi + Q)*S^{-1/2} with S = 1 + <Q|Q>.
+ * Since <Q|Q> = <dPhi|dPhi> - A^H*A, all matrices follow from a single
+ * overlap matrix of (Phi, dPhi), and Phi' from a single rotation of this
+ * vector with the returned matrix (the first N columns give Phi'). The
+ * removed part of the update only rotates the occupied space, which leaves
+ * the energy unchanged.
+ */
+ComplexMatrix GroundStateSolver::calcOrthonormalUpdate(OrbitalVector &Phi, OrbitalVector &dPhi, OrbitalVector &Phi_dPhi, DoubleVector &errors) {
+    Timer t_ovr;
+    int nOrbs = Phi.size();
+    Phi_dPhi = orbital::adjoin(Phi, dPhi);
+    ComplexMatrix S_all = orbital::calc_overlap_matrix(Phi_dPhi);
+    mrcpp::print::time(2, "Computing overlap matrix", t_ovr);
+
+    ComplexMatrix I = ComplexMatrix::Identity(nOrbs, nOrbs);
+    ComplexMatrix A = S_all.topRightCorner(nOrbs, nOrbs);
+    ComplexMatrix Q = S_all.bottomRightCorner(nOrbs, nOrbs) - A.adjoint() * A;
+    errors = Q.real().diagonal().cwiseMax(0.0).cwiseSqrt();
+
+    ComplexMatrix S_m12 = math_utils::hermitian_matrix_pow(I + Q, -1.0 / 2.0);
+    ComplexMatrix U = ComplexMatrix::Zero(2 * nOrbs, 2 * nOrbs);
+    U.topLeftCorner(nOrbs, nOrbs) = (I - A) * S_m12;
+    U.bottomLeftCorner(nOrbs, nOrbs) = S_m12;
+    return U;
+}
+
+/** @brief Write the solver state along with the checkpoint orbitals
+ *
+ * @param nIter: current iteration
+ * @param errors: current orbital errors
+ * @param kain: iterative subspace accelerator
+ * @param all_active: accelerator history contains all orbitals (none frozen)
+ *
+ * Together with the checkpoint orbitals this allows a restarted calculation
+ * to resume where it stopped: iteration counter, current precision and
+ * convergence history are written to "<chkFile>_state.json", and the
+ * accelerator history to "<chkFile>_kain_*". Only the newest iteration of
+ * the history is written in each call, see Accelerator::writeCheckpoint.
+ * The history of a subset of orbitals (some orbitals frozen) is not written.
+ */
+void GroundStateSolver::writeState(int nIter, const DoubleVector &errors, Accelerator &kain, bool all_active) {
+    std::vector<int> history;
+    if (all_active) history = kain.writeCheckpoint(this->chkFile + "_kain");
+
+    json state;
+    state["iteration"] = nIter;
+    state["orbital_prec"] = this->orbPrec[0];
+    state["accelerator"] = this->accelerator;
+    state["history"] = history;
+    state["orbital_errors"] = std::vector<double>(errors.data(), errors.data() + errors.size());
+    state["error"] = this->error;
+    state["property"] = this->property;
+    state["energy"] = json::array();
+    for (const auto &E_i : this->energy) state["energy"].push_back(E_i.json());
+
+    if (mrcpp::mpi::grand_master()) {
+        std::ofstream ofs;
+        ofs.open(this->chkFile + "_state.json", std::ios::out);
+        ofs << state.dump(2) << std::endl;
+        ofs.close();
+    }
+}
+
+/** @brief Resume from the solver state written along with the checkpoint orbitals
+ *
+ * @param nIter: iteration to resume from (out)
+ * @param errors: orbital errors (out)
+ * @param kain: iterative subspace accelerator (out)
+ *
+ * Returns false (and leaves everything unchanged) if no matching state is
+ * found, in which case the optimization starts from scratch with the
+ * current orbitals. The accelerator history is only restored if the same
+ * accelerator was used. Frozen orbitals are not restored, they will be
+ * frozen again once converged. The Fock matrix is not restored, it is
+ * computed from the checkpoint orbitals by the initial guess, which must
+ * leave the orbitals unrotated to match the restored history.
+ */
+bool GroundStateSolver::readState(int &nIter, DoubleVector &errors, Accelerator &kain) {
+    std::ifstream ifs(this->chkFile + "_state.json", std::ios_base::in);
+    if (not ifs.is_open()) {
+        MSG_WARN("No solver state found, starting from first iteration");
+        return false;
+    }
+    json state;
+    ifs >> state;
+    ifs.close();
+
+    int nOrbs = errors.size();
+    if (state["orbital_errors"].size() != nOrbs) {
+        MSG_WARN("Solver state does not match orbitals, starting from first iteration");
+        return false;
+    }
+
+    nIter = state["iteration"].get<int>();
+    this->orbPrec[0] = state["orbital_prec"].get<double>();
+    auto err = state["orbital_errors"].get<std::vector<double>>();
+    for (int i = 0; i < nOrbs; i++) errors(i) = err[i];
+    this->error = state["error"].get<std::vector<double>>();
+    this->property = state["property"].get<std::vector<double>>();
+
+    this->energy.clear();
+    for (const auto &E_i : state["energy"]) {
+        auto get = [&E_i](const std::string &key) { return E_i[key].get<double>(); };
+        // clang-format off
+        this->energy.push_back(SCFEnergy(get("E_kin"), get("E_nn"),
+                                         get("E_en"), get("E_ee"),
+                                         get("E_x"), get("E_xc"),
+                                         get("E_next"), get("E_eext"),
+                                         get("Er_tot"), get("Er_nuc"), get("Er_el")));
+        // clang-format on
+    }
+
+    if (state["accelerator"].get<std::string>() == this->accelerator) {
+        kain.readCheckpoint(this->chkFile + "_kain", state["history"].get<std::vector<int>>());
+    }
+
+    mrcpp::print::separator(0, '~');
+    print_utils::text(0, "Restart from state ", this->chkFile + "_state.json");
+    print_utils::text(0, "Restart iteration  ", std::to_string(nIter));
+    mrcpp::print::separator(0, '~', 2);
+    return true;
+}
+
 } // namespace mrchem
@@ -47,6 +47,7 @@
 
 namespace mrchem {
 
+class Accelerator;
 class Molecule;
 class FockBuilder;
 
@@ -57,16 +58,42 @@ public:
 
     void setRotation(int iter) { this->rotation = iter; }
     void setLocalize(bool loc) { this->localize = loc; }
+    void setFreezeOrbitals(bool frz) { this->freeze = frz; }
+    void setOrthonormalizeOnce(bool once) { this->orthoOnce = once; }
+    void setRotateHistory(int hist) { this->rotateHistory = hist; }
+    void setAccelerator(const std::string &name) { this->accelerator = name; }
+    void setHistoryStorage(int mem, double crop, const std::string &path) {
+        this->memHistory = mem;
+        this->cropHistory = crop;
+        this->pathHistory = path;
+    }
     void setCheckpointFile(const std::string &file) { this->chkFile = file; }
+    void setCheckpointState(bool write, bool read) {
+        this->writeChkState = write;
+        this->readChkState = read;
+    }
 
     nlohmann::json optimize(Molecule &mol, FockBuilder &F);
 
 protected:
-    int rotation{0};      ///< Number of iterations between localization/diagonalization
-    bool localize{false}; ///< Use localized or canonical orbitals
-    std::string chkFile;  ///< Name of checkpoint file
+    int rotation{0};                 ///< Number of iterations between localization/diagonalization
+    bool localize{false};            ///< Use localized or canonical orbitals
+    bool freeze{false};              ///< Skip updates of converged orbitals
+    bool orthoOnce{false};           ///< Single orthonormalization per iteration, after the KAIN step
+    std::string accelerator{"kain"}; ///< Iterative subspace accelerator (kain or diis)
+    int rotateHistory{-1};           ///< KAIN history kept through orbital rotations (negative: all)
+    int memHistory{-1};              ///< KAIN history kept in memory (negative: all)
+    double cropHistory{-1.0};        ///< Precision of older KAIN history (negative: no cropping)
+    std::string pathHistory;         ///< Directory of KAIN history not kept in memory
+    std::string chkFile;             ///< Name of checkpoint file
+    bool writeChkState{false};       ///< Write the full solver state along with the checkpoint
+    bool readChkState{false};        ///< Resume from the solver state in the checkpoint
     std::vector<SCFEnergy> energy;
 
+    std::vector<bool> frozen; ///< Orbitals that are currently frozen
+    DoubleVector frozenError; ///< Orbital residuals at the time of freezing
+    ComplexMatrix frozenFock; ///< Fock matrix rows at the time of freezing
+
     void reset() override;
     double calcPropertyError() const;
     void printProperty() const;
@@ -74,6 +101,15 @@ protected:
 
     bool needLocalization(int nIter, bool converged) const;
     bool needDiagonalization(int nIter, bool converged) const;
+
+    std::vector<int> getActiveOrbitals() const;
+    void updateFrozenOrbitals(DoubleVector &errors, const ComplexMatrix &F_mat);
+    void unfreezeOrbitals();
+    void rotateSubspace(Accelerator &kain, const ComplexMatrix &U, bool all_active);
+    ComplexMatrix calcOrthonormalUpdate(OrbitalVector &Phi, OrbitalVector &dPhi, OrbitalVector &Phi_dPhi, DoubleVector &errors);
+
+    void writeState(int nIter, const DoubleVector &errors, Accelerator &kain, bool all_active);
+    bool readState(int &nIter, DoubleVector &errors, Accelerator &kain);
 };
 
 } // namespace mrchem
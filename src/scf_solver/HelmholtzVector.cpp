@@ -23,6 +23,13 @@
  * <https://mrchem.readthedocs.io/>
  */
 
+#include <algorithm>
+#include <map>
+
+#ifdef MRCHEM_HAS_OMP
+#include <omp.h>
+#endif
+
 #include "MRCPP/MWOperators"
 #include "MRCPP/Printer"
 #include "MRCPP/Timer"
@@ -41,19 +48,273 @@ namespace mrchem {
 
 extern mrcpp::MultiResolutionAnalysis<3> *MRA; // Global MRA
 
+namespace {
+const double mu_tolerance = 1.0e-2; // Relative tolerance for sharing operators
+const double prec_band = 0.5;       // Cached operators may be this much tighter than requested
+const double nodes_per_thread = 64; // Tree nodes needed to keep one thread busy
+const double trees_per_thread = 3;  // Orbital sized trees kept alive by one application
+} // namespace
+
+std::vector<HelmholtzVector::CacheEntry> HelmholtzVector::cache;
+std::mutex HelmholtzVector::cache_lock;
+int HelmholtzVector::cache_size = 32;
+int HelmholtzVector::cache_time = 0;
+int HelmholtzVector::memory_budget = 2000;
+
 /** @brief HelmholtzVector constructor
  *
  * This will set the build precision of the Helmholtz operators and the vector
  * of lambda parameters that will be used in the subsequent application. No
  * operators are constructed at this point, they are produced on-the-fly in
  * the application.
+ *
+ * Lambda parameters that are close to an operator in the cache, or to another
+ * lambda in the same vector, are adjusted to share the same operator.
  */
 HelmholtzVector::HelmholtzVector(double pr, const DoubleVector &l)
         : prec(pr) {
     this->lambda = l;
+    std::vector<double> assigned;
     for (int i = 0; i < this->lambda.size(); i++) {
         if (this->lambda(i) > 0.0) this->lambda(i) = -0.5;
+        double mu_i = snapMu(std::sqrt(-2.0 * this->lambda(i)), assigned);
+        this->lambda(i) = -0.5 * mu_i * mu_i;
+        assigned.push_back(mu_i);
+    }
+}
+
+/** @brief Set the maximum number of cached Helmholtz operators
+ *
+ * The least recently used operators are released when the cache is full.
+ * A size of zero disables the cache.
+ */
+void HelmholtzVector::setCacheSize(int size) {
+    std::lock_guard<std::mutex> lock(cache_lock);
+    cache_size = std::max(size, 0);
+    while (static_cast<int>(cache.size()) > cache_size) {
+        auto lru = std::min_element(cache.begin(), cache.end(), [](const auto &a, const auto &b) { return a.last_use < b.last_use; });
+        cache.erase(lru);
+    }
+}
+
+/** @brief Set the memory budget (MB) for concurrent Helmholtz applications
+ *
+ * The budget is per MPI process, and limits how many orbitals are computed
+ * concurrently, see getOrbitalThreads.
+ */
+void HelmholtzVector::setMemoryBudget(int mb) {
+    memory_budget = std::max(mb, 0);
+}
+
+/** @brief Release all cached Helmholtz operators */
+void HelmholtzVector::clearCache() {
+    std::lock_guard<std::mutex> lock(cache_lock);
+    cache.clear();
+}
+
+/** @brief Find an existing Helmholtz exponent close to the given one
+ *
+ * Searches first the operator cache (at compatible precision), then the
+ * exponents already assigned to this vector, and returns the closest one
+ * within the relative tolerance. If none is found, mu is returned as is.
+ *
+ * @param[in] mu Requested Helmholtz exponent
+ * @param[in] assigned Exponents already assigned to this vector
+ */
+double HelmholtzVector::snapMu(double mu, const std::vector<double> &assigned) const {
+    double best_mu = mu;
+    double best_diff = mu_tolerance * mu;
+    {
+        std::lock_guard<std::mutex> lock(cache_lock);
+        for (const auto &entry : cache) {
+            if (entry.prec > this->prec or entry.prec < prec_band * this->prec) continue;
+            double diff = std::abs(entry.mu - mu);
+            if (diff <= best_diff) {
+                best_mu = entry.mu;
+                best_diff = diff;
+            }
+        }
     }
+    if (best_mu != mu) return best_mu;
+    for (auto mu_j : assigned) {
+        double diff = std::abs(mu_j - mu);
+        if (diff <= best_diff) {
+            best_mu = mu_j;
+            best_diff = diff;
+        }
+    }
+    return best_mu;
+}
+
+/** @brief Fetch a Helmholtz operator from the cache, or build a new one
+ *
+ * Operators are matched on mu up to round-off, since the lambda parameters
+ * have already been adjusted to the cache in the constructor. The operator is
+ * constructed outside the lock, so that several threads can build
+ * different operators at the same time.
+ *
+ * Several independent instances of the same operator can be kept in the
+ * cache, distinguished by the copy index, such that the same operator can
+ * be applied on several threads at once.
+ *
+ * @param[in] mu Helmholtz exponent
+ * @param[in] copy Index of the operator instance
+ */
+std::shared_ptr<mrcpp::HelmholtzOperator> HelmholtzVector::getOperator(double mu, int copy) const {
+    {
+        std::lock_guard<std::mutex> lock(cache_lock);
+        for (auto &entry : cache) {
+            if (entry.copy != copy) continue;
+            if (std::abs(entry.mu - mu) > 1.0e-12 * mu) continue;
+            if (entry.prec > this->prec or entry.prec < prec_band * this->prec) continue;
+            entry.last_use = cache_time++;
+            return entry.oper;
+        }
+    }
+
+    auto oper = std::make_shared<mrcpp::HelmholtzOperator>(*MRA, mu, this->prec);
+
+    std::lock_guard<std::mutex> lock(cache_lock);
+    if (cache_size > 0) {
+        if (static_cast<int>(cache.size()) >= cache_size) {
+            auto lru = std::min_element(cache.begin(), cache.end(), [](const auto &a, const auto &b) { return a.last_use < b.last_use; });
+            cache.erase(lru);
+        }
+        cache.push_back({mu, this->prec, copy, cache_time++, oper});
+    }
+    return oper;
+}
+
+/** @brief Number of orbitals to apply Helmholtz operators to concurrently
+ *
+ * A single application is parallelized internally over tree nodes, which
+ * gives poor thread utilization for small trees. The number of threads that
+ * one application can keep busy is estimated from the average tree size
+ * (nodes_per_thread nodes per thread), and the remaining threads are spent
+ * on applying several operators at once. Each concurrent application keeps
+ * a few orbital sized functions alive (input, output and intermediate), so
+ * the number of concurrent applications is further limited such that
+ * trees_per_thread copies of the largest local orbital tree fit within the
+ * memory budget of this MPI process.
+ *
+ * @param[in] Phi Input orbitals
+ * @param[in] idx Indices of the orbitals that should be computed
+ */
+int HelmholtzVector::getOrbitalThreads(OrbitalVector &Phi, const std::vector<int> &idx) const {
+    int nThreads = mrcpp::omp::n_threads;
+    int nOrbs = idx.size();
+    if (nThreads < 2 or nOrbs < 2) return 1;
+
+    double avg_nodes = 0.0;
+    double max_size = 0.0; // kB
+    for (auto i : idx) {
+        avg_nodes += Phi[i].getNNodes(NUMBER::Total);
+        max_size = std::max(max_size, static_cast<double>(Phi[i].getSizeNodes(NUMBER::Total)));
+    }
+    avg_nodes /= nOrbs;
+
+    int apply_threads = std::min(nThreads, std::max(1, static_cast<int>(avg_nodes / nodes_per_thread)));
+    int nOrbThreads = std::min(nOrbs, nThreads / apply_threads);
+    if (max_size > 0.0) {
+        double mem_threads = 1024.0 * memory_budget / (trees_per_thread * max_size);
+        if (mem_threads < nOrbThreads) nOrbThreads = static_cast<int>(mem_threads);
+    }
+    return std::max(1, nOrbThreads);
+}
+
+/** @brief Apply Helmholtz operators to a subset of orbitals
+ *
+ * With more than one orbital thread, the orbitals are distributed over an
+ * outer OpenMP loop and each application runs on a single thread. Nested
+ * parallelism is disabled during the loop, so that the total number of
+ * threads is not exceeded. All operators are fetched from the cache before
+ * the loop, such that new operators are built with all threads available.
+ *
+ * Orbitals with near-degenerate lambdas share the same operator, and the
+ * application of an operator is not thread safe (the operator band widths
+ * are recomputed in place). The loop therefore runs over groups of orbitals
+ * that share an operator instance, and each group is applied sequentially by
+ * one thread, such that no operator is ever used by two threads at once.
+ * When there are fewer groups than threads, e.g. for the x, y and z
+ * components of a batched response calculation that all share the lambdas
+ * of the unperturbed orbitals, the largest groups are split and the split
+ * off part is given its own (cached) copy of the operator.
+ *
+ * @param[in] idx Indices of the orbitals that should be computed
+ * @param[in] inp Input orbitals
+ * @param[out] out Output orbitals
+ * @param[inout] timers Timers for each orbital, resumed during application
+ * @param[in] nOrbThreads Number of orbitals to compute concurrently
+ */
+void HelmholtzVector::applyOrbitals(const std::vector<int> &idx, OrbitalVector &inp, OrbitalVector &out, std::vector<Timer> &timers, int nOrbThreads) const {
+    int nOrbs = idx.size();
+    std::vector<std::shared_ptr<mrcpp::HelmholtzOperator>> H(nOrbs);
+    for (int k = 0; k < nOrbs; k++) {
+        ComplexDouble mu_i = std::sqrt(-2.0 * this->lambda(idx[k]));
+        if (std::abs(mu_i.imag()) > mrcpp::MachineZero) MSG_ABORT("Mu cannot be complex");
+        H[k] = getOperator(mu_i.real());
+    }
+
+    if (nOrbThreads < 2) {
+        for (int k = 0; k < nOrbs; k++) {
+            int i = idx[k];
+            timers[i].resume();
+            out[i] = apply(*H[k], inp[i]);
+            timers[i].stop();
+        }
+        return;
+    }
+
+    // Group orbitals by operator, each group is handled by a single thread
+    struct Group {
+        int base;              ///< Index of the group this was split off from
+        int copy;              ///< Index of the operator instance
+        std::vector<int> orbs; ///< Orbitals (indices into idx) in this group
+    };
+    std::map<mrcpp::HelmholtzOperator *, std::vector<int>> oper2orbs;
+    for (int k = 0; k < nOrbs; k++) oper2orbs[H[k].get()].push_back(k);
+    std::vector<Group> groups;
+    for (auto &entry : oper2orbs) groups.push_back({static_cast<int>(groups.size()), 0, entry.second});
+
+    // Split the largest groups over separate operator instances until all threads are busy
+    std::vector<int> nCopies(groups.size(), 1);
+    while (static_cast<int>(groups.size()) < nOrbThreads) {
+        auto largest = std::max_element(groups.begin(), groups.end(), [](const auto &a, const auto &b) { return a.orbs.size() < b.orbs.size(); });
+        int nSplit = largest->orbs.size() / 2;
+        if (nSplit < 1) break;
+        Group split{largest->base, nCopies[largest->base]++, {largest->orbs.end() - nSplit, largest->orbs.end()}};
+        largest->orbs.resize(largest->orbs.size() - nSplit);
+        groups.push_back(split);
+    }
+    int nGroups = groups.size();
+    int nGroupThreads = std::min(nOrbThreads, nGroups);
+
+    std::vector<std::shared_ptr<mrcpp::HelmholtzOperator>> H_g(nGroups);
+    for (int g = 0; g < nGroups; g++) {
+        int k = groups[g].orbs.front();
+        if (groups[g].copy == 0) {
+            H_g[g] = H[k];
+        } else {
+            H_g[g] = getOperator(std::sqrt(-2.0 * this->lambda(idx[k])), groups[g].copy);
+        }
+    }
+
+#ifdef MRCHEM_HAS_OMP
+    int max_levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(1);
+#endif
+#pragma omp parallel for schedule(dynamic) num_threads(nGroupThreads)
+    for (int g = 0; g < nGroups; g++) {
+        for (auto k : groups[g].orbs) {
+            int i = idx[k];
+            timers[i].resume();
+            out[i] = apply(*H_g[g], inp[i]);
+            timers[i].stop();
+        }
+    }
+#ifdef MRCHEM_HAS_OMP
+    omp_set_max_active_levels(max_levels);
+#endif
 }
 
 /** @brief Apply Helmholtz operator component wise on OrbitalVector
@@ -68,22 +329,28 @@ HelmholtzVector::HelmholtzVector(double pr, const DoubleVector &l)
  *      local orbitals are computed.
  */
 OrbitalVector HelmholtzVector::operator()(OrbitalVector &Phi) const {
-    Timer t_tot, t_lap;
+    Timer t_tot;
     auto plevel = Printer::getPrintLevel();
     mrcpp::print::header(2, "Applying Helmholtz operators");
 
     int pprec = Printer::getPrecision();
     OrbitalVector out = orbital::param_copy(Phi);
+    std::vector<int> idx;
     for (int i = 0; i < Phi.size(); i++) {
-        if (not mrcpp::mpi::my_orb(out[i])) continue;
+        if (mrcpp::mpi::my_orb(out[i])) idx.push_back(i);
+    }
+    std::vector<Timer> timers(Phi.size());
+    for (auto &t : timers) t.stop();
 
-        t_lap.start();
-        out[i] = apply(i, Phi[i]);
+    int nOrbThreads = getOrbitalThreads(Phi, idx);
+    mrcpp::print::value(3, "Concurrent orbitals", nOrbThreads, "", 0, false);
+    applyOrbitals(idx, Phi, out, timers, nOrbThreads);
 
+    for (auto i : idx) {
         std::stringstream o_txt;
         o_txt << std::setw(4) << i;
         o_txt << std::setw(19) << std::setprecision(pprec) << std::scientific << out[i].norm();
-        print_utils::qmfunction(2, o_txt.str(), out[i], t_lap);
+        print_utils::qmfunction(2, o_txt.str(), out[i], timers[i]);
     }
     mrcpp::print::footer(2, t_tot, 2);
     if (plevel == 1) mrcpp::print::time(1, "Applying Helmholtz operators", t_tot);
@@ -97,7 +364,9 @@ OrbitalVector HelmholtzVector::operator()(OrbitalVector &Phi) const {
  * HelmholtzVector. Computes output as: out_i = H_i[V*phi_i + psi_i]
  *
  * Specialized version with smaller memory footprint since the full vector V*Phi
- * is never stored, but computed on the fly.
+ * is never stored, but computed on the fly. The potential is applied serially
+ * to one batch of orbitals at the time, and the Helmholtz operators for the
+ * batch are then applied concurrently, see getOrbitalThreads.
  *
  * NOTE: Helmholtz operator will be applied with _absolute_ precision
  *
@@ -106,25 +375,44 @@ OrbitalVector HelmholtzVector::operator()(OrbitalVector &Phi) const {
  *      local orbitals are computed.
  */
 OrbitalVector HelmholtzVector::apply(RankZeroOperator &V, OrbitalVector &Phi, OrbitalVector &Psi) const {
-    Timer t_tot, t_lap;
+    Timer t_tot;
     auto pprec = Printer::getPrecision();
     auto plevel = Printer::getPrintLevel();
     mrcpp::print::header(2, "Applying Helmholtz operators");
     if (Phi.size() != Psi.size()) MSG_ABORT("OrbitalVector size mismatch");
 
     OrbitalVector out = orbital::param_copy(Phi);
+    std::vector<int> idx;
     for (int i = 0; i < Phi.size(); i++) {
-        if (not mrcpp::mpi::my_orb(out[i])) continue;
+        if (mrcpp::mpi::my_orb(out[i])) idx.push_back(i);
+    }
+    std::vector<Timer> timers(Phi.size());
+    for (auto &t : timers) t.stop();
 
-        t_lap.start();
-        Orbital Vphi_i = V(Phi[i]);
-        Vphi_i.add(1.0, Psi[i]);
-        out[i] = apply(i, Vphi_i);
+    int nOrbThreads = getOrbitalThreads(Phi, idx);
+    mrcpp::print::value(3, "Concurrent orbitals", nOrbThreads, "", 0, false);
 
-        std::stringstream o_txt;
-        o_txt << std::setw(4) << i;
-        o_txt << std::setw(19) << std::setprecision(pprec) << std::scientific << out[i].norm();
-        print_utils::qmfunction(2, o_txt.str(), out[i], t_lap);
+    OrbitalVector Vphi = orbital::param_copy(Phi);
+    for (int k0 = 0; k0 < idx.size(); k0 += nOrbThreads) {
+        int k1 = std::min(k0 + nOrbThreads, static_cast<int>(idx.size()));
+        std::vector<int> batch(idx.begin() + k0, idx.begin() + k1);
+
+        // The potential is applied serially, using all threads internally
+        for (auto i : batch) {
+            timers[i].resume();
+            Vphi[i] = V(Phi[i]);
+            Vphi[i].add(1.0, Psi[i]);
+            timers[i].stop();
+        }
+        applyOrbitals(batch, Vphi, out, timers, nOrbThreads);
+        for (auto i : batch) Vphi[i].free(NUMBER::Total);
+
+        for (auto i : batch) {
+            std::stringstream o_txt;
+            o_txt << std::setw(4) << i;
+            o_txt << std::setw(19) << std::setprecision(pprec) << std::scientific << out[i].norm();
+            print_utils::qmfunction(2, o_txt.str(), out[i], timers[i]);
+        }
     }
     mrcpp::print::footer(2, t_tot, 2);
     if (plevel == 1) mrcpp::print::time(1, "Applying Helmholtz operators", t_tot);
@@ -132,17 +420,10 @@ OrbitalVector HelmholtzVector::apply(RankZeroOperator &V, OrbitalVector &Phi, Or
 }
 
 /** @brief Apply Helmholtz operator on individual Orbital
- *
- * This will construct a Helmholtz operator with the i-th component of the
- * lambda vector and apply it to the input orbital.
  *
  * Computes output as: out_i = -2H_i[phi_i]
  */
-Orbital HelmholtzVector::apply(int i, Orbital &phi) const {
-    ComplexDouble mu_i = std::sqrt(-2.0 * this->lambda(i));
-    if (std::abs(mu_i.imag()) > mrcpp::MachineZero) MSG_ABORT("Mu cannot be complex");
-    mrcpp::HelmholtzOperator H(*MRA, mu_i.real(), this->prec);
-
+Orbital HelmholtzVector::apply(mrcpp::HelmholtzOperator &H, Orbital &phi) const {
     Orbital out = phi.paramCopy();
     if (phi.hasReal()) {
         out.alloc(NUMBER::Real);
@@ -25,6 +25,12 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+
+#include <MRCPP/MWOperators>
+#include <MRCPP/Timer>
+
 #include "mrchem.h"
 #include "qmfunctions/qmfunction_fwd.h"
 #include "tensor/tensor_fwd.h"
@@ -35,6 +41,13 @@
  *
  * This class assigns one HelmholtzOperator to each orbital in an OrbitalVector.
  * The operators are produced on the fly based on a vector of lambda parameters.
+ *
+ * Operators are kept in a bounded cache that is shared between all instances,
+ * such that subsequent SCF iterations can reuse operators as the orbital
+ * energies converge. Any lambda that is within a small tolerance of a cached
+ * (or previously assigned) operator is adjusted to match it exactly. This is
+ * safe since lambda only enters as a shift that is added to both sides of the
+ * equation, as long as the Helmholtz argument is built from getLambdaMatrix().
  */
 
 namespace mrchem {
@@ -48,11 +61,33 @@ public:
     OrbitalVector apply(RankZeroOperator &V, OrbitalVector &Phi, OrbitalVector &Psi) const;
     OrbitalVector operator()(OrbitalVector &Phi) const;
 
+    static void setCacheSize(int size);
+    static void setMemoryBudget(int mb);
+    static void clearCache();
+
 private:
     double prec;         ///< Precision for construction and application of Helmholtz operators
     DoubleVector lambda; ///< Helmholtz parameter, mu_i = sqrt(-2.0*lambda_i)
 
-    Orbital apply(int i, Orbital &phi) const;
+    struct CacheEntry {
+        double mu;                                       ///< Helmholtz exponent of the operator
+        double prec;                                     ///< Build precision of the operator
+        int copy;                                        ///< Index of independent instances of the same operator
+        int last_use;                                    ///< Time stamp for least recently used eviction
+        std::shared_ptr<mrcpp::HelmholtzOperator> oper; ///< Cached operator
+    };
+    static std::vector<CacheEntry> cache;
+    static std::mutex cache_lock;
+    static int cache_size;
+    static int cache_time;
+    static int memory_budget; ///< Memory (MB) per MPI process for concurrent applications
+
+    double snapMu(double mu, const std::vector<double> &assigned) const;
+    std::shared_ptr<mrcpp::HelmholtzOperator> getOperator(double mu, int copy = 0) const;
+
+    int getOrbitalThreads(OrbitalVector &Phi, const std::vector<int> &idx) const;
+    void applyOrbitals(const std::vector<int> &idx, OrbitalVector &inp, OrbitalVector &out, std::vector<mrcpp::Timer> &timers, int nOrbThreads) const;
+    Orbital apply(mrcpp::HelmholtzOperator &H, Orbital &phi) const;
 };
 
 } // namespace mrchem
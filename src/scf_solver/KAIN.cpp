@@ -45,6 +45,11 @@ namespace mrchem {
  * and the return vectors have size nOrbs + 1. Frobenius inner product
  * used for the Fock matrix. If separateOrbitals is false the A's and b's
  * are later collected to single entities.
+ *
+ * The orbital inner products are expanded in terms of the cached matrix
+ * \f$ P_{kl} = \langle x^k | f(x^l) \rangle \f$ (see updateOverlaps),
+ * such that only the entries of the latest iteration need to be computed.
+ * The contributions of all orbitals are collected in a single MPI reduction.
  */
 void KAIN::setupLinearSystem() {
     Timer t_tot;
@@ -54,40 +59,33 @@ void KAIN::setupLinearSystem() {
     std::vector<ComplexMatrix> A_matrices;
     std::vector<ComplexVector> b_vectors;
 
+    updateOverlaps();
+
+    // A and b for each orbital stacked as [A_0 b_0 A_1 b_1 ...]
+    int m = nHistory;
     int nOrbitals = this->orbitals[nHistory].size();
+    ComplexMatrix orbAB = ComplexMatrix::Zero(nHistory, (nHistory + 1) * nOrbitals);
     for (int n = 0; n < nOrbitals; n++) {
-        auto orbA = ComplexMatrix::Zero(nHistory, nHistory).eval();
-        auto orbB = ComplexVector::Zero(nHistory).eval();
-
-        auto &phi_m = this->orbitals[nHistory][n];
-        auto &fPhi_m = this->dOrbitals[nHistory][n];
-        if (mrcpp::mpi::my_orb(phi_m)) {
-
-            for (int i = 0; i < nHistory; i++) {
-                auto &phi_i = this->orbitals[i][n];
-                auto dPhi_im = phi_m.paramCopy();
-                mrcpp::cplxfunc::add(dPhi_im, 1.0, phi_i, -1.0, phi_m, -1.0);
-
-                for (int j = 0; j < nHistory; j++) {
-                    auto &fPhi_j = this->dOrbitals[j][n];
-                    auto dfPhi_jm = fPhi_m.paramCopy();
-                    mrcpp::cplxfunc::add(dfPhi_jm, 1.0, fPhi_j, -1.0, fPhi_m, -1.0);
-
-                    // Ref. Harrisons KAIN paper the following has the wrong sign,
-                    // but we define the updates (lowercase f) with opposite sign.
-                    orbA(i, j) -= orbital::dot(dPhi_im, dfPhi_jm);
-                }
-                orbB(i) += orbital::dot(dPhi_im, fPhi_m);
+        if (not mrcpp::mpi::my_orb(this->orbitals[nHistory][n])) continue;
+
+        const auto &P = this->overlaps[n];
+        double alpha = (this->scaling.size() == nOrbitals) ? scaling[n] : 1.0;
+        int col = n * (nHistory + 1);
+        for (int i = 0; i < nHistory; i++) {
+            for (int j = 0; j < nHistory; j++) {
+                // Ref. Harrisons KAIN paper the following has the wrong sign,
+                // but we define the updates (lowercase f) with opposite sign.
+                orbAB(i, col + j) = -alpha * (P(i, j) - P(i, m) - P(m, j) + P(m, m));
             }
+            orbAB(i, col + nHistory) = P(i, m) - P(m, m);
         }
-        double alpha = (this->scaling.size() == nOrbitals) ? scaling[n] : 1.0;
-        A_matrices.push_back(orbA * alpha);
-        b_vectors.push_back(orbB);
     }
+    mrcpp::mpi::allreduce_matrix(orbAB, mrcpp::mpi::comm_wrk);
 
-    for (int i = 0; i < nOrbitals; i++) {
-        mrcpp::mpi::allreduce_matrix(A_matrices[i], mrcpp::mpi::comm_wrk);
-        mrcpp::mpi::allreduce_vector(b_vectors[i], mrcpp::mpi::comm_wrk);
+    for (int n = 0; n < nOrbitals; n++) {
+        int col = n * (nHistory + 1);
+        A_matrices.push_back(orbAB.block(0, col, nHistory, nHistory));
+        b_vectors.push_back(orbAB.col(col + nHistory));
     }
 
     // Fock matrix is treated as a whole using the Frobenius inner product
@@ -133,54 +131,66 @@ void KAIN::expandSolution(double prec, OrbitalVector &Phi, OrbitalVector &dPhi,
     // Orbitals are unchanged, updates are overwritten
     dPhi = orbital::param_copy(this->dOrbitals[nHistory]);
 
-    int m = 0;
+    // Latest update enters with unit coefficient
+    std::vector<std::vector<ComplexDouble>> totCoefs(nOrbitals);
+    std::vector<std::vector<mrcpp::ComplexFunction>> totOrbs(nOrbitals);
     for (int n = 0; n < nOrbitals; n++) {
-        if (this->sepOrbitals) m = n;
-        if (mrcpp::mpi::my_orb(Phi[n])) {
-            std::vector<ComplexDouble> totCoefs;
-            std::vector<mrcpp::ComplexFunction> totOrbs;
+        if (not mrcpp::mpi::my_orb(Phi[n])) continue;
+        totCoefs[n].push_back({1.0, 0.0});
+        totOrbs[n].push_back(this->dOrbitals[nHistory][n]);
+    }
+
+    // Iterations are looped in the outer loop, such that each iteration
+    // kept on disk is read only once
+    for (int j = 0; j < nHistory; j++) {
+        loadHistory(j);
+        int m = 0;
+        for (int n = 0; n < nOrbitals; n++) {
+            if (this->sepOrbitals) m = n;
+            if (not mrcpp::mpi::my_orb(Phi[n])) continue;
 
             auto &phi_m = this->orbitals[nHistory][n];
             auto &fPhi_m = this->dOrbitals[nHistory][n];
-            totCoefs.push_back({1.0, 0.0});
-            totOrbs.push_back(fPhi_m);
 
             // Ref. Harrisons KAIN paper the following has the wrong sign,
             // but we define the updates (lowercase f) with opposite sign
             // (but not the orbitals themselves).
-            for (int j = 0; j < nHistory; j++) {
-                ComplexVector partCoefs(4);
-                std::vector<mrcpp::ComplexFunction> partOrbs;
+            ComplexVector partCoefs(4);
+            std::vector<mrcpp::ComplexFunction> partOrbs;
 
-                partCoefs(0) = {1.0, 0.0};
-                auto &phi_j = this->orbitals[j][n];
-                partOrbs.push_back(phi_j);
+            partCoefs(0) = {1.0, 0.0};
+            auto &phi_j = this->orbitals[j][n];
+            partOrbs.push_back(phi_j);
 
-                partCoefs(1) = {1.0, 0.0};
-                auto &fPhi_j = this->dOrbitals[j][n];
-                partOrbs.push_back(fPhi_j);
+            partCoefs(1) = {1.0, 0.0};
+            auto &fPhi_j = this->dOrbitals[j][n];
+            partOrbs.push_back(fPhi_j);
 
-                partCoefs(2) = {-1.0, 0.0};
-                partOrbs.push_back(phi_m);
+            partCoefs(2) = {-1.0, 0.0};
+            partOrbs.push_back(phi_m);
 
-                partCoefs(3) = {-1.0, 0.0};
-                partOrbs.push_back(fPhi_m);
+            partCoefs(3) = {-1.0, 0.0};
+            partOrbs.push_back(fPhi_m);
 
-                auto partStep = phi_m.paramCopy();
-                mrcpp::cplxfunc::linear_combination(partStep, partCoefs, partOrbs, prec);
+            auto partStep = phi_m.paramCopy();
+            mrcpp::cplxfunc::linear_combination(partStep, partCoefs, partOrbs, prec);
 
-                auto c_j = this->c[m](j);
-                totCoefs.push_back(c_j);
-                totOrbs.push_back(partStep);
-            }
+            auto c_j = this->c[m](j);
+            totCoefs[n].push_back(c_j);
+            totOrbs[n].push_back(partStep);
+        }
+        releaseHistory(j);
+    }
+
+    for (int n = 0; n < nOrbitals; n++) {
+        if (not mrcpp::mpi::my_orb(Phi[n])) continue;
 
-            // std::vector -> ComplexVector
-            ComplexVector coefsVec(totCoefs.size());
-            for (int i = 0; i < totCoefs.size(); i++) coefsVec(i) = totCoefs[i];
+        // std::vector -> ComplexVector
+        ComplexVector coefsVec(totCoefs[n].size());
+        for (int i = 0; i < totCoefs[n].size(); i++) coefsVec(i) = totCoefs[n][i];
 
-            dPhi[n] = Phi[n].paramCopy();
-            mrcpp::cplxfunc::linear_combination(dPhi[n], coefsVec, totOrbs, prec);
-        }
+        dPhi[n] = Phi[n].paramCopy();
+        mrcpp::cplxfunc::linear_combination(dPhi[n], coefsVec, totOrbs[n], prec);
     }
 
     // Treat Fock matrix as a whole using Frobenius inner product
@@ -191,7 +201,7 @@ void KAIN::expandSolution(double prec, OrbitalVector &Phi, OrbitalVector &dPhi,
         const auto &fX_m = this->dFock[nHistory];
         auto fockStep = ComplexMatrix::Zero(nOrbitals, nOrbitals).eval();
         fockStep = fX_m;
-        m = this->c.size();
+        int m = this->c.size();
         for (int j = 0; j < nHistory; j++) {
             const auto &X_j = this->fock[j];
             const auto &fX_j = this->dFock[j];
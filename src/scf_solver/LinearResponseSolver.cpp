@@ -59,6 +59,11 @@ namespace mrchem {
  *  4) Compute property
  *  5) Check for convergence
  *
+ * If the right-hand side (1 - rho_0)V_1(phi_i) is purely real or purely imaginary
+ * in the first iteration (e.g. magnetic perturbations of a real ground state), the
+ * response orbitals keep this phase by symmetry, and any numerical noise in the
+ * other part is removed such that only one half of each function is ever computed.
+ *
  */
 json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_0, FockBuilder &F_1) {
     printParameters(omega, F_1.perturbation().name());
@@ -93,6 +98,10 @@ json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_
     ComplexMatrix L_mat_x = H_x.getLambdaMatrix();
     ComplexMatrix L_mat_y = H_y.getLambdaMatrix();
 
+    // Common phase of the right-hand sides, determined in the first iteration
+    int phase_x = NUMBER::Total;
+    int phase_y = NUMBER::Total;
+
     auto plevel = Printer::getPrintLevel();
     if (plevel < 1) {
         printConvergenceHeader("Symmetric property");
@@ -128,6 +137,7 @@ json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_
 
             t_lap.start();
             orbital::orthogonalize(this->orth_prec, Psi_1, Phi_0);
+            if (nIter == 1) phase_x = orbital::get_pure_phase(Psi_1);
             mrcpp::print::time(2, "Projecting (1 - rho_0)", t_lap);
 
             t_lap.start();
@@ -135,6 +145,7 @@ json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_
             mrcpp::print::time(2, "Rotating orbitals", t_lap);
 
             OrbitalVector Psi = orbital::add(1.0, Psi_1, 1.0, Psi_2, -1.0);
+            orbital::set_pure_phase(Psi, phase_x);
             Psi_1.clear();
             Psi_2.clear();
             mrcpp::print::footer(2, t_arg, 2);
@@ -148,6 +159,7 @@ json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_
             mrcpp::print::header(2, "Projecting occupied space");
             t_lap.start();
             orbital::orthogonalize(this->orth_prec, X_np1, Phi_0);
+            orbital::set_pure_phase(X_np1, phase_x);
             mrcpp::print::time(2, "Projecting (1 - rho_0)", t_lap);
             mrcpp::print::footer(2, t_lap, 2);
             if (plevel == 1) mrcpp::print::time(1, "Projecting occupied space", t_lap);
@@ -162,6 +174,7 @@ json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_
 
             // Prepare for next iteration
             X_n = orbital::add(1.0, X_n, 1.0, dX_n);
+            orbital::set_pure_phase(X_n, phase_x);
 
             // Save checkpoint file
             if (this->checkpoint) orbital::save_orbitals(X_n, this->chkFileX);
@@ -179,6 +192,7 @@ json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_
 
             t_lap.start();
             orbital::orthogonalize(this->orth_prec, Psi_1, Phi_0);
+            if (nIter == 1) phase_y = orbital::get_pure_phase(Psi_1);
             mrcpp::print::time(2, "Projecting (1 - rho_0)", t_lap);
 
             t_lap.start();
@@ -186,6 +200,7 @@ json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_
             mrcpp::print::time(2, "Rotating orbitals", t_lap);
 
             OrbitalVector Psi = orbital::add(1.0, Psi_1, 1.0, Psi_2, -1.0);
+            orbital::set_pure_phase(Psi, phase_y);
             Psi_1.clear();
             Psi_2.clear();
             mrcpp::print::footer(2, t_arg, 2);
@@ -199,6 +214,7 @@ json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_
             mrcpp::print::header(2, "Projecting occupied space");
             t_lap.start();
             orbital::orthogonalize(this->orth_prec, Y_np1, Phi_0);
+            orbital::set_pure_phase(Y_np1, phase_y);
             mrcpp::print::time(2, "Projecting (1 - rho_0)", t_lap);
             mrcpp::print::footer(2, t_lap, 2);
             if (plevel == 1) mrcpp::print::time(1, "Projecting occupied space", t_lap);
@@ -213,6 +229,7 @@ json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_
 
             // Prepare for next iteration
             Y_n = orbital::add(1.0, Y_n, 1.0, dY_n);
+            orbital::set_pure_phase(Y_n, phase_y);
 
             // Save checkpoint file
             if (this->checkpoint) orbital::save_orbitals(Y_n, this->chkFileY);
@@ -268,6 +285,253 @@ json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_
     return json_out;
 }
 
+/** @brief Run orbital optimization for several response components simultaneously
+ *
+ * Same algorithm as the single component version, but all components (e.g. the
+ * x, y and z directions of the perturbation) are iterated together:
+ *
+ *  - The unperturbed potential and the Helmholtz operators are shared
+ *  - The Helmholtz operators are applied to all components in one batch
+ *  - The occupied space is projected out of all components in one pass
+ *  - Each component has its own perturbed Fock operator and KAIN history
+ *  - Each component converges independently, and is not updated once converged
+ *
+ * The convergence thresholds apply to each component separately. The property
+ * in the convergence table is the sum of the symmetric properties (the trace).
+ */
+json LinearResponseSolver::optimize(double omega, Molecule &mol, FockBuilder &F_0, std::vector<ResponseComponent> &comps) {
+    printParameters(omega, comps[0].F_1->perturbation().name());
+    Timer t_tot;
+    json json_out;
+
+    int nComps = comps.size();
+    int nSweeps = (dynamic) ? 2 : 1;
+    OrbitalVector &Phi_0 = mol.getOrbitals();
+    int nOrbs = Phi_0.size();
+
+    ComplexMatrix &F_mat_0 = mol.getFockMatrix();
+    ComplexMatrix F_mat[2];
+    F_mat[0] = F_mat_0 + omega * ComplexMatrix::Identity(nOrbs, nOrbs);
+    F_mat[1] = F_mat_0 - omega * ComplexMatrix::Identity(nOrbs, nOrbs);
+
+    // Setup KAIN accelerators and perturbed potentials for each component
+    std::vector<std::unique_ptr<KAIN>> kain[2];
+    std::vector<RankZeroOperator> V_1;
+    for (auto &comp : comps) {
+        kain[0].push_back(std::make_unique<KAIN>(this->history));
+        kain[1].push_back(std::make_unique<KAIN>(this->history));
+        V_1.push_back(comp.F_1->potential() + comp.F_1->perturbation());
+    }
+    RankZeroOperator V_0 = F_0.potential();
+
+    double err_o = 1.0;
+    double err_t = 1.0;
+    std::vector<DoubleVector> errors[2];
+    errors[0] = std::vector<DoubleVector>(nComps, DoubleVector::Zero(nOrbs));
+    errors[1] = std::vector<DoubleVector>(nComps, DoubleVector::Zero(nOrbs));
+    std::vector<std::vector<double>> props(nComps, std::vector<double>(1, 0.0));
+    std::vector<bool> converged(nComps, false);
+
+    this->error.push_back(err_t);
+    this->property.push_back(0.0);
+
+    double helm_prec = getHelmholtzPrec();
+
+    // Common phase of the right-hand sides, determined in the first iteration
+    int phase[2] = {NUMBER::Total, NUMBER::Total};
+
+    auto plevel = Printer::getPrintLevel();
+    if (plevel < 1) {
+        printConvergenceHeader("Symmetric property");
+        printConvergenceRow(0);
+    }
+
+    int nIter = 0;
+    bool all_converged = false;
+    std::vector<json> json_comps(nComps);
+    for (auto &json_comp : json_comps) json_comp["cycles"] = {};
+    while (nIter++ < this->maxIter or this->maxIter < 0) {
+        std::stringstream o_header;
+        o_header << "SCF cycle " << nIter;
+        mrcpp::print::header(1, o_header.str(), 0, '#');
+        mrcpp::print::separator(2, ' ', 1);
+
+        // Initialize SCF cycle
+        Timer t_scf, t_lap;
+        double orb_prec = adjustPrecision(err_o);
+
+        // Only components that are not yet converged are updated
+        std::vector<int> active;
+        for (int d = 0; d < nComps; d++) {
+            if (not converged[d]) active.push_back(d);
+        }
+        int nActive = active.size();
+
+        // Setup perturbed Fock operators (including V_1)
+        for (auto d : active) comps[d].F_1->setup(orb_prec);
+
+        // Iterate X (s = 0) and Y (s = 1) orbitals
+        for (int s = 0; s < nSweeps; s++) {
+            if (dynamic and plevel == 1) mrcpp::print::separator(1, '-');
+
+            // Setup Helmholtz operators (fixed, based on unperturbed system),
+            // one copy of the operators for each active component. The lambdas are
+            // snapped over the full vector, so each copy may differ slightly and the
+            // argument of each component must use its own block of the lambda matrix
+            HelmholtzVector H(helm_prec, F_mat[s].real().diagonal().replicate(nActive, 1));
+            ComplexMatrix L_all = H.getLambdaMatrix();
+
+            // Compute argument: psi_i = sum_j [L-F]_ij*x_j + (1 - rho_0)V_1(phi_i)
+            Timer t_arg;
+            mrcpp::print::header(2, "Computing Helmholtz argument");
+            t_lap.start();
+            OrbitalVector Psi_1;
+            for (auto d : active) {
+                OrbitalVector Psi_d = (s == 0) ? V_1[d](Phi_0) : V_1[d].dagger(Phi_0);
+                for (auto &psi_i : Psi_d) Psi_1.push_back(psi_i);
+            }
+            mrcpp::print::time(2, (s == 0) ? "Applying V_1" : "Applying V_1.dagger()", t_lap);
+
+            t_lap.start();
+            orbital::orthogonalize(this->orth_prec, Psi_1, Phi_0);
+            if (nIter == 1) phase[s] = orbital::get_pure_phase(Psi_1);
+            mrcpp::print::time(2, "Projecting (1 - rho_0)", t_lap);
+
+            t_lap.start();
+            OrbitalVector X_n, Psi_2;
+            for (int k = 0; k < nActive; k++) {
+                OrbitalVector &X_d = (s == 0) ? *comps[active[k]].X : *comps[active[k]].Y;
+                ComplexMatrix L_mat = L_all.block(k * nOrbs, k * nOrbs, nOrbs, nOrbs);
+                OrbitalVector Psi_d = orbital::rotate(X_d, L_mat - F_mat[s]);
+                for (int i = 0; i < nOrbs; i++) {
+                    X_n.push_back(X_d[i]);
+                    Psi_2.push_back(Psi_d[i]);
+                }
+            }
+            mrcpp::print::time(2, "Rotating orbitals", t_lap);
+
+            OrbitalVector Psi = orbital::add(1.0, Psi_1, 1.0, Psi_2, -1.0);
+            orbital::set_pure_phase(Psi, phase[s]);
+            Psi_1.clear();
+            Psi_2.clear();
+            mrcpp::print::footer(2, t_arg, 2);
+            if (plevel == 1) mrcpp::print::time(1, "Computing Helmholtz argument", t_arg);
+
+            // Apply Helmholtz operators to all active components in one batch
+            OrbitalVector X_np1 = H.apply(V_0, X_n, Psi);
+            Psi.clear();
+            X_n.clear();
+
+            // Projecting (1 - rho_0)X
+            mrcpp::print::header(2, "Projecting occupied space");
+            t_lap.start();
+            orbital::orthogonalize(this->orth_prec, X_np1, Phi_0);
+            orbital::set_pure_phase(X_np1, phase[s]);
+            mrcpp::print::time(2, "Projecting (1 - rho_0)", t_lap);
+            mrcpp::print::footer(2, t_lap, 2);
+            if (plevel == 1) mrcpp::print::time(1, "Projecting occupied space", t_lap);
+
+            for (int k = 0; k < nActive; k++) {
+                int d = active[k];
+                OrbitalVector &X_d = (s == 0) ? *comps[d].X : *comps[d].Y;
+                OrbitalVector X_dp1;
+                for (int i = 0; i < nOrbs; i++) X_dp1.push_back(X_np1[k * nOrbs + i]);
+
+                // Compute update and errors
+                OrbitalVector dX_d = orbital::add(1.0, X_dp1, -1.0, X_d);
+                errors[s][d] = orbital::get_norms(dX_d);
+                X_dp1.clear();
+
+                // Compute KAIN update:
+                kain[s][d]->accelerate(orb_prec, X_d, dX_d);
+
+                // Prepare for next iteration
+                X_d = orbital::add(1.0, X_d, 1.0, dX_d);
+                orbital::set_pure_phase(X_d, phase[s]);
+
+                // Save checkpoint file
+                if (this->checkpoint) orbital::save_orbitals(X_d, (s == 0) ? comps[d].chkFileX : comps[d].chkFileY);
+            }
+        }
+
+        // Compute properties
+        mrcpp::print::header(2, "Computing symmetric property");
+        t_lap.start();
+        for (auto d : active) {
+            auto &comp = comps[d];
+            double prop = comp.F_1->perturbation().trace(Phi_0, *comp.X, *comp.Y).real();
+            props[d].push_back(prop);
+        }
+        mrcpp::print::footer(2, t_lap, 2);
+        if (plevel == 1) mrcpp::print::time(1, "Computing symmetric property", t_lap);
+
+        // Clear perturbed Fock operators
+        for (auto d : active) comps[d].F_1->clear();
+
+        // Compute errors and check convergence of each component
+        err_o = 0.0;
+        err_t = 0.0;
+        double prop_sum = 0.0;
+        all_converged = true;
+        for (int d = 0; d < nComps; d++) {
+            double err_o_d = std::max(errors[0][d].maxCoeff(), errors[1][d].maxCoeff());
+            double err_t_d = std::sqrt(errors[0][d].dot(errors[0][d]) + errors[1][d].dot(errors[1][d]));
+            prop_sum += props[d].back();
+            if (not converged[d]) {
+                double err_p_d = getUpdate(props[d], props[d].size(), true);
+                converged[d] = checkConvergence(err_o_d, err_p_d);
+
+                json json_cycle;
+                json_cycle["mo_residual"] = err_t_d;
+                json_cycle["symmetric_property"] = props[d].back();
+                json_cycle["property_update"] = err_p_d;
+                json_cycle["wall_time"] = t_scf.elapsed();
+                json_comps[d]["cycles"].push_back(json_cycle);
+
+                // Precision follows the components that are still active
+                err_o = std::max(err_o, err_o_d);
+            }
+            err_t += err_t_d * err_t_d;
+            all_converged = (all_converged and converged[d]);
+        }
+        err_t = std::sqrt(err_t);
+
+        // Collect convergence data
+        this->error.push_back(err_t);
+        this->property.push_back(prop_sum);
+
+        // Finalize SCF cycle
+        if (plevel < 1) printConvergenceRow(nIter);
+        for (auto d : active) {
+            printOrbitals(orbital::get_norms(*comps[d].X), errors[0][d], *comps[d].X, 1);
+            if (dynamic) printOrbitals(orbital::get_norms(*comps[d].Y), errors[1][d], *comps[d].Y, 1, false);
+        }
+        mrcpp::print::separator(1, '-');
+        printResidual(err_t, all_converged);
+        mrcpp::print::separator(2, '=', 2);
+        printProperty(props, converged);
+        printMemory();
+        t_scf.stop();
+        mrcpp::print::footer(1, t_scf, 2, '#');
+        mrcpp::print::separator(2, ' ', 2);
+
+        if (all_converged) break;
+    }
+
+    printConvergence(all_converged, "Symmetric property");
+    reset();
+
+    json_out["components"] = {};
+    for (int d = 0; d < nComps; d++) {
+        json_comps[d]["wall_time"] = t_tot.elapsed();
+        json_comps[d]["converged"] = bool(converged[d]);
+        json_out["components"].push_back(json_comps[d]);
+    }
+    json_out["wall_time"] = t_tot.elapsed();
+    json_out["converged"] = all_converged;
+    return json_out;
+}
+
 /** @brief Pretty printing of the computed property with update */
 void LinearResponseSolver::printProperty() const {
     double prop_0(0.0), prop_1(0.0);
@@ -295,6 +559,41 @@ void LinearResponseSolver::printProperty() const {
     mrcpp::print::separator(2, '=', 2);
 }
 
+/** @brief Pretty printing of the computed properties of several components with update
+ *
+ * The convergence status of each component accounts for both the orbital
+ * residual and the property update.
+ */
+void LinearResponseSolver::printProperty(const std::vector<std::vector<double>> &props, const std::vector<bool> &converged) const {
+    int w0 = (Printer::getWidth() - 1);
+    int w1 = 20;
+    int w2 = w0 / 3;
+    int w3 = 8;
+    int w4 = w0 - w1 - w2 - w3;
+
+    std::stringstream o_head;
+    o_head << std::setw(w1) << " ";
+    o_head << std::setw(w2) << "Value";
+    o_head << std::setw(w4) << "Update";
+    o_head << std::setw(w3) << "Done";
+
+    mrcpp::print::separator(2, '=');
+    println(2, o_head.str());
+    mrcpp::print::separator(2, '-');
+
+    for (int d = 0; d < props.size(); d++) {
+        double prop_0(0.0), prop_1(0.0);
+        int iter = props[d].size();
+        if (iter > 1) prop_0 = props[d][iter - 2];
+        if (iter > 0) prop_1 = props[d][iter - 1];
+
+        std::stringstream o_txt;
+        o_txt << " Symmetric property " << d;
+        printUpdate(1, o_txt.str(), prop_1, prop_1 - prop_0, static_cast<bool>(converged[d]));
+    }
+    mrcpp::print::separator(2, '=', 2);
+}
+
 void LinearResponseSolver::printParameters(double omega, const std::string &oper) const {
     std::stringstream o_calc;
     o_calc << "Optimize linear response orbitals";
@@ -25,6 +25,8 @@
 
 #pragma once
 
+#include <memory>
+
 #include <nlohmann/json.hpp>
 
 #include "SCFSolver.h"
@@ -38,6 +40,15 @@ namespace mrchem {
 class Molecule;
 class FockBuilder;
 
+/** @brief Perturbed Fock operator, orbitals and checkpoint files of one response component */
+struct ResponseComponent {
+    FockBuilder *F_1{nullptr};        ///< Perturbed Fock operator, including the perturbation
+    std::shared_ptr<OrbitalVector> X; ///< Perturbed orbitals (X)
+    std::shared_ptr<OrbitalVector> Y; ///< Perturbed orbitals (Y), same as X for static response
+    std::string chkFileX;             ///< Name of checkpoint file
+    std::string chkFileY;             ///< Name of checkpoint file
+};
+
 class LinearResponseSolver final : public SCFSolver {
 public:
     explicit LinearResponseSolver(bool dyn = false)
@@ -45,6 +56,7 @@ public:
     ~LinearResponseSolver() override = default;
 
     nlohmann::json optimize(double omega, Molecule &mol, FockBuilder &F_0, FockBuilder &F_1);
+    nlohmann::json optimize(double omega, Molecule &mol, FockBuilder &F_0, std::vector<ResponseComponent> &comps);
     void setOrthPrec(double prec) { this->orth_prec = prec; }
     void setCheckpointFile(const std::string &file_x, const std::string &file_y) {
         this->chkFileX = file_x;
@@ -58,6 +70,7 @@ protected:
     std::string chkFileY; ///< Name of checkpoint file
 
     void printProperty() const;
+    void printProperty(const std::vector<std::vector<double>> &props, const std::vector<bool> &converged) const;
     void printParameters(double omega, const std::string &oper) const;
 };
 
@@ -146,6 +146,18 @@ double SCFSolver::getUpdate(const std::vector<double> &vec, int i, bool absPrec)
  * Adds convergence status based on the property threshold.
  */
 void SCFSolver::printUpdate(int plevel, const std::string &txt, double P, double dP, double thrs) const {
+    bool done = (std::abs(dP) < thrs) or (thrs < 0.0);
+    printUpdate(plevel, txt, P, dP, done);
+}
+
+/** @brief Pretty printing of property update
+ *
+ * @param name: name of property
+ * @param P: current value
+ * @param dP: current update
+ * @param done: convergence status
+ */
+void SCFSolver::printUpdate(int plevel, const std::string &txt, double P, double dP, bool done) const {
     int pprec = Printer::getPrecision();
     int w0 = (Printer::getWidth() - 1);
     int w1 = 25;
@@ -153,8 +165,6 @@ void SCFSolver::printUpdate(int plevel, const std::string &txt, double P, double
     int w3 = 8;
     int w4 = w0 - w1 - w2 - w3;
 
-    bool done = (std::abs(dP) < thrs) or (thrs < 0.0);
-
     std::stringstream o_row;
     o_row << txt << std::string(w1 - txt.size(), ' ');
     o_row << std::setw(w2) << std::setprecision(2 * pprec) << std::fixed << P;
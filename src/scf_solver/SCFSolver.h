@@ -84,6 +84,7 @@ protected:
 
     double getUpdate(const std::vector<double> &vec, int i, bool absPrec) const;
     void printUpdate(int plevel, const std::string &txt, double P, double dP, double thrs) const;
+    void printUpdate(int plevel, const std::string &txt, double P, double dP, bool done) const;
 
     bool checkConvergence(double err_o, double err_p) const;
     void printConvergence(bool converged, const std::string &txt) const;
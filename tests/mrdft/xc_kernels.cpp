@@ -0,0 +1,75 @@
+/*
+ * MRChem, a numerical real-space code for molecular electronic structure
+ * calculations within the self-consistent field (SCF) approximations of quantum
+ * chemistry (Hartree-Fock and Density Functional Theory).
+ * Copyright (C) 2023 Stig Rune Jensen, Luca Frediani, Peter Wind and contributors.
+ *
+ * This file is part of MRChem.
+ *
+ * MRChem is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MRChem is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with MRChem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * For information on the complete list of contributors to MRChem, see:
+ * <https://mrchem.readthedocs.io/>
+ */
+
+#include "catch.hpp"
+
+#include <memory>
+#include <vector>
+
+#include <XCFun/xcfun.h>
+
+#include "mrdft/xc_kernels.h"
+
+namespace xc_kernels {
+
+using XC_p = std::unique_ptr<xcfun_t, decltype(&xcfun_delete)>;
+
+// Every point is evaluated by XCFun, including zero and tiny densities,
+// such that the density screening of the kernels is tested as well
+std::vector<double> eval_xcfun(const std::string &name, int order, const std::vector<double> &rho) {
+    XC_p fun(xcfun_new(), xcfun_delete);
+    xcfun_set(fun.get(), name.c_str(), 1.0);
+    xcfun_user_eval_setup(fun.get(), order, 0, 1, 1, 0, 0, 0, 0);
+    int nOut = xcfun_output_length(fun.get());
+    std::vector<double> out(nOut * rho.size(), 0.0);
+    for (int i = 0; i < rho.size(); i++) xcfun_eval(fun.get(), &rho[i], &out[i * nOut]);
+    return out;
+}
+
+TEST_CASE("Native LDA kernels", "[xc_kernels]") {
+    const double thrs = 1.0e-10;
+    std::vector<double> rho = {0.0, 1.0e-16, 1.0e-15, 2.0e-14, 1.0e-12, 1.0e-10, 1.0e-6, 1.0e-3, 0.1, 1.0, 10.0, 1.0e3, 1.0e5};
+    int nPts = rho.size();
+
+    for (int order = 0; order <= 2; order++) {
+        int nOut = order + 1;
+        SECTION("Slater exchange, order " + std::to_string(order)) {
+            std::vector<double> out(nOut * nPts, 0.0);
+            mrdft::xc_kernels::slater_x(order, nPts, rho.data(), out.data(), nOut, 1.0);
+            auto ref = eval_xcfun("slaterx", order, rho);
+            REQUIRE(ref.size() == out.size());
+            for (int i = 0; i < out.size(); i++) REQUIRE(out[i] == Approx(ref[i]).epsilon(thrs).margin(thrs));
+        }
+        SECTION("VWN5 correlation, order " + std::to_string(order)) {
+            std::vector<double> out(nOut * nPts, 0.0);
+            mrdft::xc_kernels::vwn5_c(order, nPts, rho.data(), out.data(), nOut, 1.0);
+            auto ref = eval_xcfun("vwn5c", order, rho);
+            REQUIRE(ref.size() == out.size());
+            for (int i = 0; i < out.size(); i++) REQUIRE(out[i] == Approx(ref[i]).epsilon(thrs).margin(thrs));
+        }
+    }
+}
+
+} // namespace xc_kernels
@@ -0,0 +1,98 @@
+/*
+ * MRChem, a numerical real-space code for molecular electronic structure
+ * calculations within the self-consistent field (SCF) approximations of quantum
+ * chemistry (Hartree-Fock and Density Functional Theory).
+ * Copyright (C) 2023 Stig Rune Jensen, Luca Frediani, Peter Wind and contributors.
+ *
+ * This file is part of MRChem.
+ *
+ * MRChem is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MRChem is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with MRChem.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * For information on the complete list of contributors to MRChem, see:
+ * <https://mrchem.readthedocs.io/>
+ */
+
+#include "catch.hpp"
+
+#include "MRCPP/MWOperators"
+
+#include "mrchem.h"
+
+#include "analyticfunctions/HydrogenFunction.h"
+#include "qmfunctions/Orbital.h"
+#include "qmfunctions/orbital_utils.h"
+#include "qmoperators/one_electron/H_M_pso.h"
+#include "qmoperators/one_electron/MomentumOperator.h"
+#include "qmoperators/qmoperator_utils.h"
+
+using namespace mrchem;
+using namespace orbital;
+
+namespace pso_trace {
+
+using QuantumNumbers = std::tuple<int, int, int>;
+
+TEST_CASE("PSOTrace", "[pso_trace]") {
+    const double prec = 1.0e-3;
+    const double thrs = 1.0e-2;
+    const double smooth = 1.0e-1;
+
+    std::vector<QuantumNumbers> qn_phi, qn_x;
+    qn_phi.push_back(QuantumNumbers(1, 0, 0));
+    qn_phi.push_back(QuantumNumbers(2, 1, 0));
+    qn_x.push_back(QuantumNumbers(2, 1, 1));
+    qn_x.push_back(QuantumNumbers(2, 1, 2));
+    int nFuncs = qn_phi.size();
+
+    // orbitals centered off the nuclei to get non-zero traces in all directions
+    mrcpp::Coord<3> o{0.1, 0.2, -0.1};
+
+    OrbitalVector Phi, X;
+    for (int i = 0; i < nFuncs; i++) Phi.push_back(Orbital(SPIN::Paired));
+    for (int i = 0; i < nFuncs; i++) X.push_back(Orbital(SPIN::Paired));
+    Phi.distribute();
+    X.distribute();
+
+    for (int i = 0; i < nFuncs; i++) {
+        HydrogenFunction f(std::get<0>(qn_phi[i]), std::get<1>(qn_phi[i]), std::get<2>(qn_phi[i]), 1.0, o);
+        HydrogenFunction g(std::get<0>(qn_x[i]), std::get<1>(qn_x[i]), std::get<2>(qn_x[i]), 1.0, o);
+        if (mrcpp::mpi::my_orb(Phi[i])) mrcpp::cplxfunc::project(Phi[i], f, NUMBER::Real, prec);
+        if (mrcpp::mpi::my_orb(X[i])) mrcpp::cplxfunc::project(X[i], g, NUMBER::Real, prec);
+    }
+    OrbitalVector Y = orbital::deep_copy(X);
+
+    std::vector<mrcpp::Coord<3>> r_K;
+    r_K.push_back({0.0, 0.0, 0.0});
+    r_K.push_back({0.5, 0.0, -0.3});
+    r_K.push_back({-0.4, 0.6, 0.2});
+
+    auto D = std::make_shared<mrcpp::ABGVOperator<3>>(*MRA, 0.5, 0.5);
+    MomentumOperator p(D);
+    p.setup(prec);
+    ComplexMatrix traces = qmoperator::calc_pso_trace(p, r_K, prec, smooth, Phi, X, Y);
+    p.clear();
+
+    for (int k = 0; k < r_K.size(); k++) {
+        H_M_pso h(D, r_K[k], prec, smooth);
+        h.setup(prec);
+        ComplexVector ref = h.trace(Phi, X, Y);
+        h.clear();
+        for (int d = 0; d < 3; d++) {
+            REQUIRE(traces(k, d).real() == Approx(ref(d).real()).epsilon(thrs).margin(thrs));
+            REQUIRE(traces(k, d).imag() == Approx(ref(d).imag()).epsilon(thrs).margin(thrs));
+        }
+    }
+}
+
+} // namespace pso_trace
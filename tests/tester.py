@@ -65,7 +65,7 @@ def GEOMETRIC_DERIVATIVE(index, comp):
     return ("output", "properties", "geometric_derivative", f"geom-{index}", comp)
 
 
-def run(options, *, input_file, filters=None, extra_args=None):
+def run(options, *, input_file, filters=None, extra_args=None, reference=None):
     launcher = "mrchem"
     launcher_full_path = Path(options.binary_dir).joinpath(launcher).resolve()
 
@@ -105,8 +105,15 @@ def run(options, *, input_file, filters=None, extra_args=None):
             print(f"\nstderr\n{child.stderr}")
             return 137
 
+    # no filters: run only, e.g. to prepare a restart or a reference
+    if filters is None:
+        return 0
+
     computed = Path(options.work_dir) / f"{inp_no_suffix}.json"
     expected = caller_dir / f"reference/{inp_no_suffix}.json"
+    if reference is not None:
+        # compare with the output of another calculation in this test
+        expected = Path(options.work_dir) / f"{reference}.json"
     with computed.open("r") as o_json, expected.open("r") as r_json:
         out = json.load(o_json)
         ref = json.load(r_json)